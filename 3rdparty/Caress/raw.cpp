@@ -1043,7 +1043,7 @@ int32 get_data_partition_r(struct raw_infovars* pVars, void* addr, int32 section
     char* temp_addr;
     char* current_poi;
     int32 remaining_length;
-    int64 i, j, k;
+    int64 i, k;
     int32 f_status = 0;
     int32 istatus;
     int32 bConvertInt64ToDouble = 0;
@@ -1115,21 +1115,13 @@ int32 get_data_partition_r(struct raw_infovars* pVars, void* addr, int32 section
 #ifdef RAW_ONLINE
     istatus = mutex_file_lock(RAW_DATA_RSC, NULL);
 #endif
-    for (j = 0; j < k; ++j) {
-        f_status = fseeko(pVars->m_raw_data_file, starting_byte_no, SEEK_SET);
-        if (f_status < 0)
-            break;
-        f_status = fread(current_poi, BLOCK_LENGTH, 1, pVars->m_raw_data_file);
-        if (f_status < 1)
-            break;
-        starting_byte_no += BLOCK_LENGTH;
-        current_poi += BLOCK_LENGTH;
-    }
-    if (f_status > 0 && remaining_length > 0) {
-        f_status = fseeko(pVars->m_raw_data_file, starting_byte_no, SEEK_SET);
-        if (f_status == 0)
-            f_status = fread(current_poi, remaining_length, 1, pVars->m_raw_data_file);
-    }
+    /* the partition is contiguous in the file, so read it at once */
+    f_status = fseeko(pVars->m_raw_data_file, starting_byte_no, SEEK_SET);
+    if (f_status == 0)
+        f_status = fread(current_poi, k * BLOCK_LENGTH + remaining_length, 1,
+                         pVars->m_raw_data_file);
+    else
+        f_status = 0;
     if (f_status < 1)
         istatus = NOT_OK;
 #ifdef RAW_ONLINE
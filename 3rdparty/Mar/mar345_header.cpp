@@ -75,6 +75,29 @@ extern void	RemoveBlanks	(char *);
  */
 MAR345_HEADER	Getmar345Header		(FILE *);
 MAR345_HEADER	Setmar345Header		(void  );
+static char *	NextToken		(char *, char **);
+
+/******************************************************************
+ * Function: NextToken
+ * Like strtok( str, " " ), but keeps its position in *pos,
+ * so that several headers can be parsed concurrently.
+ ******************************************************************/
+static char *NextToken(char *str, char **pos)
+{
+char	*ret;
+
+    if ( str == NULL ) str = *pos;
+    while ( *str == ' ' ) str++;
+    if ( *str == '\0' ) {
+        *pos = str;
+        return( NULL );
+    }
+    ret = str;
+    while ( *str != ' ' && *str != '\0' ) str++;
+    if ( *str == ' ' ) *str++ = '\0';
+    *pos = str;
+    return( ret );
+}
 
 /******************************************************************
  * Function: Getmar345Header
@@ -84,7 +107,7 @@ MAR345_HEADER  Getmar345Header(FILE *fp)
 MAR345_HEADER	h;
 int 		i,j, ntok=0,fpos=0;
 int		ngaps = 0;
-char 		str[64], buf[128], *key, *token[20];
+char 		str[64], buf[128], *key, *token[20], *pos;
 int		head[32];
 
 
@@ -167,14 +190,14 @@ int		head[32];
         }
         if (strlen(buf) < 3 ) continue;
 
-        key = strtok( buf, " ");
+        key = NextToken( buf, &pos );
 
         /* Convert keyword to uppercase */
         for ( i=0; i<strlen(key); i++ )
             if ( isalnum( key[i] ) ) key[i] = toupper( key[i] );
 
         for(i=0;i<ntok;i++) {
-            token[i] = strtok( NULL, " ");
+            token[i] = NextToken( NULL, &pos );
             strcpy( str, token[i] );
 
             for ( j=0; j<strlen( str ); j++ )
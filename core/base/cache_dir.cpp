@@ -0,0 +1,71 @@
+//  ***********************************************************************************************
+//
+//  Steca: stress and texture calculator
+//
+//! @file      core/base/cache_dir.cpp
+//! @brief     Implements functions in namespace cache_dir
+//!
+//! @homepage  https://github.com/scgmlz/Steca
+//! @license   GNU General Public License v3 or higher (see COPYING)
+//! @copyright Forschungszentrum Jülich GmbH 2016-2018
+//! @authors   Scientific Computing Group at MLZ (see CITATION, MAINTAINER)
+//
+//  ***********************************************************************************************
+
+#include "core/base/cache_dir.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+
+namespace {
+
+QString subdirPath(const QString& subdir)
+{
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (dir.isEmpty())
+        return {};
+    return QDir(dir).filePath(subdir);
+}
+
+} // namespace
+
+namespace cache_dir {
+
+//! Returns the name of the cache file for the given key, or an empty string if there is no
+//! cache location. Creates the subdirectory if needed.
+QString filePath(const QString& subdir, const QByteArray& key)
+{
+    const QString dir = subdirPath(subdir);
+    if (dir.isEmpty() || !QDir().mkpath(dir))
+        return {};
+    const QByteArray hash = QCryptographicHash::hash(key, QCryptographicHash::Sha1);
+    return QDir(dir).filePath(QString(hash.toHex()) + ".bin");
+}
+
+//! Sets the modification time of a cache file to now, so that it is evicted last.
+void markUsed(const QString& path)
+{
+    QFile file(path);
+    if (file.open(QIODevice::ReadWrite)) // does not truncate
+        file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+}
+
+//! Removes the least recently used files of the subdirectory until its total size is within
+//! the budget. The most recently used file is never removed.
+void trim(const QString& subdir, qint64 budget)
+{
+    const QString dir = subdirPath(subdir);
+    if (dir.isEmpty())
+        return;
+    const auto files = QDir(dir).entryInfoList({"*.bin"}, QDir::Files, QDir::Time); // newest first
+    qint64 total = 0;
+    for (const QFileInfo& info : files)
+        total += info.size();
+    for (int i=files.size()-1; i>0 && total>budget; --i)
+        if (QFile::remove(files[i].absoluteFilePath())) // fails if in use, on some systems
+            total -= files[i].size();
+}
+
+} // namespace cache_dir
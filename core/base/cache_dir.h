@@ -0,0 +1,35 @@
+//  ***********************************************************************************************
+//
+//  Steca: stress and texture calculator
+//
+//! @file      core/base/cache_dir.h
+//! @brief     Declares functions in namespace cache_dir
+//!
+//! @homepage  https://github.com/scgmlz/Steca
+//! @license   GNU General Public License v3 or higher (see COPYING)
+//! @copyright Forschungszentrum Jülich GmbH 2016-2018
+//! @authors   Scientific Computing Group at MLZ (see CITATION, MAINTAINER)
+//
+//  ***********************************************************************************************
+
+#ifndef CACHE_DIR_H
+#define CACHE_DIR_H
+
+#include <QString>
+
+class QByteArray;
+
+//! Files in subdirectories of the user cache directory, each subdirectory with a size budget.
+
+//! Files are named after a hash of their key. The modification time of a file tells when it was
+//! last used; if a subdirectory exceeds its budget, the least recently used files are removed.
+
+namespace cache_dir {
+
+QString filePath(const QString& subdir, const QByteArray& key);
+void markUsed(const QString& path);
+void trim(const QString& subdir, qint64 budget);
+
+} // namespace cache_dir
+
+#endif // CACHE_DIR_H
@@ -0,0 +1,50 @@
+//  ***********************************************************************************************
+//
+//  Steca: stress and texture calculator
+//
+//! @file      core/base/parallel.cpp
+//! @brief     Implements functions numThreads, numChunks, forChunks in namespace parallel
+//!
+//! @homepage  https://github.com/scgmlz/Steca
+//! @license   GNU General Public License v3 or higher (see COPYING)
+//! @copyright Forschungszentrum Jülich GmbH 2016-2018
+//! @authors   Scientific Computing Group at MLZ (see CITATION, MAINTAINER)
+//
+//  ***********************************************************************************************
+
+#include "core/base/parallel.h"
+#include <algorithm>
+#include <future>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+//! Returns the number of hardware threads, at least 1.
+int numThreads()
+{
+    static const int ret = std::max(1, (int)std::thread::hardware_concurrency());
+    return ret;
+}
+
+//! Returns the number of chunks into which forChunks will split n work items.
+int numChunks(int n)
+{
+    return std::max(1, std::min(n, numThreads()));
+}
+
+void forChunks(int n, const std::function<void(int iChunk, int begin, int end)>& f)
+{
+    if (n<=0)
+        return;
+    const int nChunks = numChunks(n);
+    auto chunkBegin = [n, nChunks](int i) { return int((long long)n * i / nChunks); };
+    std::vector<std::future<void>> futures;
+    for (int i=1; i<nChunks; ++i)
+        futures.push_back(std::async(std::launch::async, f, i, chunkBegin(i), chunkBegin(i+1)));
+    f(0, 0, chunkBegin(1)); // the calling thread takes the first chunk
+    for (std::future<void>& future : futures)
+        future.get(); // rethrows exception from worker thread
+}
+
+} // namespace parallel
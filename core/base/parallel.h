@@ -0,0 +1,36 @@
+//  ***********************************************************************************************
+//
+//  Steca: stress and texture calculator
+//
+//! @file      core/base/parallel.h
+//! @brief     Defines functions numThreads, numChunks, forChunks in namespace parallel
+//!
+//! @homepage  https://github.com/scgmlz/Steca
+//! @license   GNU General Public License v3 or higher (see COPYING)
+//! @copyright Forschungszentrum Jülich GmbH 2016-2018
+//! @authors   Scientific Computing Group at MLZ (see CITATION, MAINTAINER)
+//
+//  ***********************************************************************************************
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <functional>
+
+//! Minimal support for data-parallel loops.
+
+//! The work function must not touch lazily computed data (gSession caches etc),
+//! since these are not thread safe. Prepare them in the calling thread.
+
+namespace parallel {
+
+int numThreads();
+int numChunks(int n);
+
+//! Splits [0,n) into numChunks(n) contiguous chunks, and calls f(iChunk, begin, end) for
+//! each chunk in its own thread. Returns when all chunks are done; rethrows exceptions.
+void forChunks(int n, const std::function<void(int iChunk, int begin, int end)>& f);
+
+} // namespace parallel
+
+#endif // PARALLEL_H
@@ -21,18 +21,29 @@
 
 namespace {
 
-//! Computes average diffractogram.
-Curve computeAvgCurve(const ActiveClusters*const ac)
+//! Flattens the Cluster-Measurement hierarchy into one list.
+std::vector<const Measurement*> allMeasurements(const ActiveClusters*const ac)
 {
-    TakesLongTime __{"computeAvgCurve"};
-    // flatten Cluster-Measurement hierarchy into one Sequence
-    std::vector<const Measurement*> group;
+    std::vector<const Measurement*> ret;
     for (const Cluster* cluster : ac->clusters.yield())
         for (const Measurement* one: cluster->members())
-            group.push_back(one);
-    const Sequence seq(group);
-    // then compute the dfgram
-    return algo::projectCluster(seq, seq.rangeGma());
+            ret.push_back(one);
+    return ret;
+}
+
+//! Computes the raw intensities of all active measurements, projected together.
+Histogram computeAvgHistogram(const ActiveClusters*const ac)
+{
+    TakesLongTime __{"computeAvgHistogram"};
+    const Sequence seq(allMeasurements(ac));
+    return algo::projectSlices(seq, seq.rangeGma(), 1, false).front();
+}
+
+//! Computes average diffractogram by normalizing the cached raw intensities.
+Curve computeAvgCurve(const ActiveClusters*const ac)
+{
+    const Sequence seq(allMeasurements(ac));
+    return algo::histogramToCurve(ac->avgHistogram.yield(), seq.normFactor());
 }
 
 Range computeRgeGma(const ActiveClusters*const ac)
@@ -48,9 +59,13 @@ Range computeRgeFixedInten(const ActiveClusters*const ac)
     bool trans = false; bool cut = false; // TODO restore (broken after d97148958)
     Range ret;
     TakesLongTime __{"rgeFixedInten"};
+    const Corrset& corrset = gSession->corrset;
+    const bool useCorrected = corrset.useCorrectedImages();
     for (const Cluster* cluster : ac->clusters.yield())
         for (const Measurement* one : cluster->members())
-            ret.extendBy(ImageLens(one->image(), trans, cut).rgeInten(false));
+            ret.extendBy(useCorrected
+                         ? ImageLens(corrset.correctedImage(*one), trans, cut, true).rgeInten(false)
+                         : ImageLens(*one->image(), trans, cut).rgeInten(false));
     return ret;
 }
 
@@ -73,6 +88,8 @@ double recomputeAvg(const ActiveClusters*const ac, std::function<double(const Me
 ActiveClusters::ActiveClusters()
     : clusters {[]()->std::vector<const Cluster*>{
         return gSession->dataset.activeClustersList();}}
+    , avgHistogram {[this]()->Histogram{
+        return computeAvgHistogram(this);}}
     , avgDfgram {[this]()->Dfgram{
         return Dfgram(computeAvgCurve(this));}}
     , rgeGma {[this]()->Range{
@@ -102,6 +119,7 @@ void ActiveClusters::invalidate() const
 
 void ActiveClusters::invalidateAvg() const
 {
+    avgHistogram.invalidate();
     avgDfgram.invalidate();
     rgeFixedInten.invalidate();
     rgeGma.invalidate();
@@ -13,13 +13,15 @@
 //  ***********************************************************************************************
 
 #include "core/base/angles.h"
+#include "core/typ/size2d.h"
 #include "qcr/base/debug.h" // ASSERT
+#include <algorithm>
 #include <vector>
 
 namespace {
 
 //! Returns index i for which v[i-1]<x<=v[i], provided i1<=i<i2.
-static int lowerBound(const std::vector<deg>& vec, deg x, int i1, int i2)
+inline int lowerBound(const std::vector<deg>& vec, deg x, int i1, int i2)
 {
     ASSERT(i1 < i2);
     if (i2-i1 == 1)
@@ -31,7 +33,7 @@ static int lowerBound(const std::vector<deg>& vec, deg x, int i1, int i2)
 }
 
 //! Returns index i for which v[i-1]<=x<v[i], provided i1<i<=i2.
-static int upperBound(const std::vector<deg>& vec, deg x, int i1, int i2)
+inline int upperBound(const std::vector<deg>& vec, deg x, int i1, int i2)
 {
     ASSERT(i1 < i2);
     if (i2-i1 == 1)
@@ -42,104 +44,613 @@ static int upperBound(const std::vector<deg>& vec, deg x, int i1, int i2)
         : upperBound(vec, x, mid, i2); // ... we should be so lucky
 }
 
+//! Merges two lists of (gma, index) pairs, each sorted by gamma and then by index,
+//! into one list sorted the same way; returns result in sortedGmas, sortedIndexes.
+inline void mergeByGamma(
+    const std::vector<deg>& gmas1, const std::vector<int>& indexes1,
+    const std::vector<deg>& gmas2, const std::vector<int>& indexes2,
+    std::vector<deg>& sortedGmas, std::vector<int>& sortedIndexes)
+{
+    ASSERT(gmas1.size() == indexes1.size());
+    ASSERT(gmas2.size() == indexes2.size());
+    const int n1 = gmas1.size();
+    const int n2 = gmas2.size();
+    sortedGmas.resize(n1 + n2);
+    sortedIndexes.resize(n1 + n2);
+    int k1 = 0, k2 = 0;
+    for (int k=0; k<n1+n2; ++k) {
+        const bool takeFirst = k2 == n2 || (k1 < n1
+            && (gmas1[k1] < gmas2[k2] || (gmas1[k1] == gmas2[k2] && indexes1[k1] < indexes2[k2])));
+        if (takeFirst) {
+            sortedGmas[k] = gmas1[k1];
+            sortedIndexes[k] = indexes1[k1++];
+        } else {
+            sortedGmas[k] = gmas2[k2];
+            sortedIndexes[k] = indexes2[k2++];
+        }
+    }
+}
+
+//! Numbers of pixel columns or rows cut away at the edges of an image.
+struct PixelCut {
+    int left, right, top, bottom;
+};
+
+//! Returns true if the pixel with the given index is within the cut.
+inline bool isInCut(int ind, const size2d& size, const PixelCut& cut)
+{
+    const int i = ind % size.w;
+    const int j = ind / size.w;
+    return i >= cut.left && i < size.w - cut.right && j >= cut.top && j < size.h - cut.bottom;
+}
+
+//! Sorts (gma, index) pairs by gamma, stable; returns result in sortedGmas, sortedIndexes.
+
+//! Bucket sort: with one bucket per value, the buckets hold about one value each,
+//! so that the final insertion sort within buckets takes linear time.
+
+inline void sortByGamma(
+    const std::vector<deg>& gmas, const std::vector<int>& indexes, double gmaMin, double gmaMax,
+    std::vector<deg>& sortedGmas, std::vector<int>& sortedIndexes)
+{
+    const int n = gmas.size();
+    sortedGmas.resize(n);
+    sortedIndexes.resize(n);
+    if (!n)
+        return;
+    const double scale = gmaMax > gmaMin ? n / (gmaMax - gmaMin) : 0;
+    auto bucketOf = [&](double gma)->int {
+        return qMax(0, qMin(int((gma - gmaMin) * scale), n - 1)); };
+
+    // counting sort by bucket, stable
+    std::vector<int> bucketStart(n + 1, 0);
+    for (int k=0; k<n; ++k)
+        ++bucketStart[bucketOf(gmas[k]) + 1];
+    for (int b=0; b<n; ++b)
+        bucketStart[b + 1] += bucketStart[b];
+    std::vector<int> pos(bucketStart.begin(), bucketStart.end() - 1);
+    for (int k=0; k<n; ++k) {
+        const int dest = pos[bucketOf(gmas[k])]++;
+        sortedGmas[dest] = gmas[k];
+        sortedIndexes[dest] = indexes[k];
+    }
+
+    // insertion sort within buckets, stable
+    for (int b=0; b<n; ++b) {
+        for (int k=bucketStart[b]+1; k<bucketStart[b+1]; ++k) {
+            const deg gma = sortedGmas[k];
+            const int ind = sortedIndexes[k];
+            int l = k;
+            for (; l>bucketStart[b] && gma<sortedGmas[l-1]; --l) {
+                sortedGmas[l] = sortedGmas[l-1];
+                sortedIndexes[l] = sortedIndexes[l-1];
+            }
+            sortedGmas[l] = gma;
+            sortedIndexes[l] = ind;
+        }
+    }
+}
+
+//! Computes the gamma-sorted list of all pixels that are within the cut and not excluded;
+//! gmaMin, gmaMax must cover their gammas. Ties are ordered by index.
+inline void sortInCut(
+    const std::vector<deg>& allGmas, const size2d& size, const PixelCut& cut,
+    const std::vector<char>& excluded, double gmaMin, double gmaMax,
+    std::vector<deg>& sortedGmas, std::vector<int>& sortedIndexes)
+{
+    const int countAfterCut = (size.w - cut.left - cut.right) * (size.h - cut.top - cut.bottom);
+    ASSERT(countAfterCut > 0);
+    ASSERT(excluded.empty() || excluded.size() == size.count());
+    std::vector<deg> gmas;
+    std::vector<int> indexes;
+    gmas.reserve(countAfterCut);
+    indexes.reserve(countAfterCut);
+    for (int j = cut.top, jEnd = size.h - cut.bottom; j < jEnd; ++j) {
+        for (int i = cut.left, iEnd = size.w - cut.right; i < iEnd; ++i) {
+            const int ind = j * size.w + i;
+            if (excluded.empty() || !excluded[ind]) {
+                gmas.push_back(allGmas[ind]);
+                indexes.push_back(ind);
+            }
+        }
+    }
+    sortByGamma(gmas, indexes, gmaMin, gmaMax, sortedGmas, sortedIndexes);
+}
+
+//! Computes the same list as sortInCut(.., newCut, ..) from the one sorted for oldCut:
+//! pixels no longer within the cut are dropped, and those newly uncovered are merged in.
+inline void deriveInCut(
+    const std::vector<deg>& allGmas, const size2d& size, const PixelCut& oldCut,
+    const PixelCut& newCut, const std::vector<char>& excluded,
+    const std::vector<deg>& oldGmas, const std::vector<int>& oldIndexes,
+    std::vector<deg>& sortedGmas, std::vector<int>& sortedIndexes)
+{
+    ASSERT(excluded.empty() || excluded.size() == size.count());
+    // pixels that remain within the cut; still sorted
+    std::vector<deg> keptGmas;
+    std::vector<int> keptIndexes;
+    keptGmas.reserve(oldGmas.size());
+    keptIndexes.reserve(oldGmas.size());
+    for (int k=0; k<oldGmas.size(); ++k) {
+        if (isInCut(oldIndexes[k], size, newCut)) {
+            keptGmas.push_back(oldGmas[k]);
+            keptIndexes.push_back(oldIndexes[k]);
+        }
+    }
+
+    // pixels that were cut away before, in strips along the edges
+    std::vector<int> stripIndexes;
+    auto addColumns = [&](int j, int iBegin, int iEnd) {
+        for (int i=iBegin; i<iEnd; ++i) {
+            const int ind = j * size.w + i;
+            if (excluded.empty() || !excluded[ind])
+                stripIndexes.push_back(ind);
+        }
+    };
+    const int iBegin = newCut.left, iEnd = size.w - newCut.right;
+    const int iOldBegin = oldCut.left, iOldEnd = size.w - oldCut.right;
+    for (int j = newCut.top, jEnd = size.h - newCut.bottom; j < jEnd; ++j) {
+        if (j < oldCut.top || j >= size.h - oldCut.bottom) {
+            addColumns(j, iBegin, iEnd);
+        } else {
+            addColumns(j, iBegin, qMin(iEnd, iOldBegin));
+            addColumns(j, qMax(iBegin, iOldEnd), iEnd);
+        }
+    }
+    std::sort(stripIndexes.begin(), stripIndexes.end(), [&allGmas](int ind1, int ind2) {
+            const double gma1 = allGmas[ind1];
+            const double gma2 = allGmas[ind2];
+            return gma1 < gma2 || (gma1 == gma2 && ind1 < ind2); });
+    std::vector<deg> stripGmas(stripIndexes.size());
+    for (int k=0; k<stripIndexes.size(); ++k)
+        stripGmas[k] = allGmas[stripIndexes[k]];
+
+    mergeByGamma(keptGmas, keptIndexes, stripGmas, stripIndexes, sortedGmas, sortedIndexes);
+}
+
 } // local methods
 
 #ifndef LOCAL_CODE_ONLY
 
 #include "core/data/angle_map.h"
+#include "core/base/cache_dir.h"
 #include "core/session.h"
 #include <qmath.h>
+#include "core/base/parallel.h"
+#include <QFile>
+#include <QSaveFile>
+#include <cstring>
 #include <iostream> // for debugging
 
-AngleMap::AngleMap(const deg tth)
+namespace {
+
+//! Header of an AngleMap cache file; followed by the arrays
+//! tths, gmas of all pixels (each w*h deg), gmas_ (count deg), and gmaIndexes_ (count int).
+//! The ranges are not stored; they are recomputed from the angles.
+struct CacheHeader {
+    char magic[8];
+    qint32 w, h, count;
+    qint32 pixOffsetX, pixOffsetY;
+    qint32 cutLeft, cutRight, cutTop, cutBottom;
+    qint32 reserved;
+    char maskHash[20]; //!< zero if no mask
+    qint32 reserved2;
+    double midTth, detectorDistance, pixSize;
+    quint64 checksum; //!< of the arrays; zero in the key
+};
+
+const char cacheMagic[8] = {'S','t','e','c','a','A','M','3'};
+static_assert(sizeof(deg)==sizeof(double), "deg must have the memory layout of double");
+
+CacheHeader headerFromKey(const AngleMapKey& key)
+{
+    CacheHeader ret;
+    std::memset(&ret, 0, sizeof(ret));
+    std::memcpy(ret.magic, cacheMagic, sizeof(cacheMagic));
+    ret.w = key.imageSize.w;
+    ret.h = key.imageSize.h;
+    ret.pixOffsetX = key.pixOffsetX;
+    ret.pixOffsetY = key.pixOffsetY;
+    ret.cutLeft = key.cutLeft;
+    ret.cutRight = key.cutRight;
+    ret.cutTop = key.cutTop;
+    ret.cutBottom = key.cutBottom;
+    ret.midTth = key.midTth;
+    ret.detectorDistance = key.detectorDistance;
+    ret.pixSize = key.pixSize;
+    std::memcpy(ret.maskHash, key.maskHash.constData(),
+                qMin(key.maskHash.size(), (int)sizeof(ret.maskHash)));
+    return ret;
+}
+
+//! Adds numBytes of data to a running checksum (FNV-1a on 64-bit words); fast enough not to
+//! slow down reading a cache file noticeably. Adding consecutive pieces gives the same as adding
+//! them at once, as long as all pieces but the last are multiples of 8 bytes.
+quint64 checksum(quint64 sum, const void* data, qint64 numBytes)
+{
+    const quint64 prime = 1099511628211ULL;
+    const char* p = static_cast<const char*>(data);
+    qint64 i = 0;
+    for (; i + 8 <= numBytes; i += 8) {
+        quint64 word;
+        std::memcpy(&word, p + i, 8);
+        sum = (sum ^ word) * prime;
+    }
+    for (; i < numBytes; ++i)
+        sum = (sum ^ quint64(uchar(p[i]))) * prime;
+    return sum;
+}
+
+const quint64 checksumSeed = 14695981039346656037ULL;
+
+//! Returns true if the header describes an AngleMap with the given key.
+bool headerMatches(const CacheHeader& h, const AngleMapKey& key)
+{
+    const CacheHeader k = headerFromKey(key);
+    return !std::memcmp(h.magic, k.magic, sizeof(k.magic))
+        && h.w == k.w && h.h == k.h && h.pixOffsetX == k.pixOffsetX && h.pixOffsetY == k.pixOffsetY
+        && h.cutLeft == k.cutLeft && h.cutRight == k.cutRight
+        && h.cutTop == k.cutTop && h.cutBottom == k.cutBottom
+        && h.midTth == k.midTth && h.detectorDistance == k.detectorDistance
+        && h.pixSize == k.pixSize && !std::memcmp(h.maskHash, k.maskHash, sizeof(k.maskHash));
+}
+
+//! Returns the cache file name for the given key, or an empty string if there is no cache dir.
+QString cachePath(const AngleMapKey& key)
+{
+    const CacheHeader h = headerFromKey(key);
+    return cache_dir::filePath(
+        "anglemaps", QByteArray(reinterpret_cast<const char*>(&h), sizeof(h)));
+}
+
+//! Total size of the angle map cache files, in bytes.
+const qint64 cacheBudget = qint64(2) << 30;
+
+PixelCut cutOf(const AngleMapKey& key)
+{
+    return {key.cutLeft, key.cutRight, key.cutTop, key.cutBottom};
+}
+
+//! Returns true if the pixel angles for the two keys are the same, regardless of cut and mask.
+bool sameAngles(const AngleMapKey& k1, const AngleMapKey& k2)
+{
+    return k1.midTth == k2.midTth && k1.imageSize == k2.imageSize
+        && k1.detectorDistance == k2.detectorDistance && k1.pixSize == k2.pixSize
+        && k1.pixOffsetX == k2.pixOffsetX && k1.pixOffsetY == k2.pixOffsetY;
+}
+
+//! All existing AngleMaps, oldest first; candidates for sharing angles with a new one.
+//! Like the LruCache that owns the maps, not thread safe.
+std::vector<const AngleMap*>& liveMaps()
+{
+    static std::vector<const AngleMap*> ret;
+    return ret;
+}
+
+} // namespace
+
+//  ***********************************************************************************************
+//! @class AngleMapKey
+
+AngleMapKey::AngleMapKey(deg midTth_)
+    : midTth{midTth_}
+    , imageSize{gSession->imageSize()}
 {
-    size_ = gSession->imageSize();
-    arrAngles_.resize(size_.count());
     const Detector& geo = gSession->params.detector;
+    detectorDistance = geo.detectorDistance.val();
+    pixSize = geo.pixSize.val();
+    pixOffsetX = geo.pixOffset[0].val();
+    pixOffsetY = geo.pixOffset[1].val();
+    const ImageCut& cut = gSession->params.imageCut;
+    cutLeft = cut.left.val();
+    cutRight = cut.right.val();
+    cutTop = cut.top.val();
+    cutBottom = cut.bottom.val();
+    maskHash = gSession->detectorMask.hash();
+}
+
+bool AngleMapKey::operator==(const AngleMapKey& other) const
+{
+    return midTth == other.midTth && imageSize == other.imageSize
+        && detectorDistance == other.detectorDistance && pixSize == other.pixSize
+        && pixOffsetX == other.pixOffsetX && pixOffsetY == other.pixOffsetY
+        && cutLeft == other.cutLeft && cutRight == other.cutRight
+        && cutTop == other.cutTop && cutBottom == other.cutBottom
+        && maskHash == other.maskHash;
+}
+
+//  ***********************************************************************************************
+//! @class AngleMap
+
+AngleMap::AngleMap(const AngleMapKey& key)
+    : key_{key}
+    , size_{key.imageSize}
+{
+    ASSERT(size_.w > key.cutLeft + key.cutRight);
+    ASSERT(size_.h > key.cutTop + key.cutBottom);
+    const AngleMap* sibling = nullptr; // most recent AngleMap with the same angles
+    for (const AngleMap* other : liveMaps())
+        if (sameAngles(other->key_, key))
+            sibling = other;
+
+    if (sibling && sibling->key_.maskHash == key.maskHash) {
+        // only the cut differs; deriving is faster than reading a cache file
+        deriveFrom(*sibling);
+    } else {
+        if (sibling)
+            angles_ = sibling->angles_;
+        const QString path = cachePath(key);
+        if (path.isEmpty() || !readCache(path)) {
+            if (!angles_)
+                computeAngles();
+            computeRanges();
+            sortPixels();
+            if (!path.isEmpty())
+                writeCache(path);
+        }
+    }
+    liveMaps().push_back(this);
+}
+
+AngleMap::~AngleMap()
+{
+    std::vector<const AngleMap*>& maps = liveMaps();
+    maps.erase(std::find(maps.begin(), maps.end(), this));
+}
+
+//! Computes 2theta and gamma of all pixels.
+void AngleMap::computeAngles()
+{
+    const AngleMapKey& key = key_;
+    std::shared_ptr<PixelAngles> angles(new PixelAngles);
+    angles->tths.resize(size_.count());
+    angles->gmas.resize(size_.count());
     // compute angles:
     //    detector center is at vec{d} = (d_x, 0, )
     //    detector pixel (i,j) is at vec{b}
-    const double t = tth.toRad();
+    const double t = key.midTth.toRad();
     const double c = cos(t);
     const double s = sin(t);
-    const double d_z = geo.detectorDistance.val();
+    const double d_z = key.detectorDistance;
     const double b_x1 = d_z * s;
     const double b_z1 = d_z * c;
-    int midPixX = size_.w/2 + geo.pixOffset[0].val();
-    int midPixY = size_.h/2 + geo.pixOffset[1].val();
+    int midPixX = size_.w/2 + key.pixOffsetX;
+    int midPixY = size_.h/2 + key.pixOffsetY;
+    // column-dependent terms, shared by all rows
+    std::vector<double> b_xs(size_.w), b_x2s(size_.w), b_zs(size_.w);
     for (int i=0; i<size_.w; ++i) {
-        const double d_x = (i - midPixX) * geo.pixSize.val();
-        const double b_x = b_x1 + d_x * c;
-        const double b_z = b_z1 - d_x * s;
-        const double b_x2 = b_x * b_x;
-        for (int j=0; j<size_.h; ++j) {
-            const double b_y = (midPixY - j) * geo.pixSize.val(); // == d_y
-            const double b_r = sqrt(b_x2 + b_y * b_y);
-            const rad gma = atan2(b_y, b_x);
-            const rad tth = atan2(b_r, b_z);
-            arrAngles_[pointToIndex(i, j)] = {tth.toDeg(), gma.toDeg()};
-        }
+        const double d_x = (i - midPixX) * key.pixSize;
+        b_xs[i] = b_x1 + d_x * c;
+        b_zs[i] = b_z1 - d_x * s;
+        b_x2s[i] = b_xs[i] * b_xs[i];
     }
+    // rows in parallel; inner loops run over contiguous memory
+    parallel::forChunks(size_.h, [&](int, int jBegin, int jEnd) {
+            for (int j=jBegin; j<jEnd; ++j) {
+                const double b_y = (midPixY - j) * key.pixSize; // == d_y
+                const double b_y2 = b_y * b_y;
+                deg* const tthRow = &angles->tths[pointToIndex(0, j)];
+                deg* const gmaRow = &angles->gmas[pointToIndex(0, j)];
+                for (int i=0; i<size_.w; ++i) {
+                    const double b_r = sqrt(b_x2s[i] + b_y2);
+                    gmaRow[i] = rad(atan2(b_y, b_xs[i])).toDeg();
+                    tthRow[i] = rad(atan2(b_r, b_zs[i])).toDeg();
+                }
+            }
+        });
+    angles_ = angles;
+}
 
-    const ImageCut& cut = gSession->params.imageCut;
-    ASSERT(size_.w > cut.horiz());
-    ASSERT(size_.h > cut.vertical());
-    const int countAfterCut = (size_.w - cut.horiz()) * (size_.h - cut.vertical());
-    ASSERT(countAfterCut > 0);
+//! Computes the ranges rgeTth_, rgeGma_, rgeGmaFull_ of the pixels within the cut.
 
-    // compute ranges rgeTth_, rgeGma_, rgeGmaFull_, and arrays gmas_, gmaIndexes_:
+//! Masked pixels count for the ranges, so that the 2theta binning does not depend on the mask.
+
+void AngleMap::computeRanges()
+{
     rgeTth_.invalidate();
     rgeGma_.invalidate();
     rgeGmaFull_.invalidate();
-    gmas_.resize(countAfterCut);
-    gmaIndexes_.resize(countAfterCut);
-    int gi = 0;
-    for (int j = cut.top.val(), jEnd = size_.h - cut.bottom.val(); j < jEnd; ++j) {
-        for (int i = cut.left.val(), iEnd = size_.w - cut.right.val(); i < iEnd; ++i) {
-            // (loop order j-i results in faster stable_sort than order i-j)
-            const ScatterDirection& dir = arrAngles_[pointToIndex(i, j)];
-            gmas_[gi] = dir.gma;
-            gmaIndexes_[gi] = pointToIndex(i, j);
-            ++gi;
-            rgeTth_.extendBy(dir.tth);
-            rgeGmaFull_.extendBy(dir.gma);
+    for (int j = key_.cutTop, jEnd = size_.h - key_.cutBottom; j < jEnd; ++j) {
+        for (int i = key_.cutLeft, iEnd = size_.w - key_.cutRight; i < iEnd; ++i) {
+            const int ind = pointToIndex(i, j);
+            const deg gma = angles_->gmas[ind];
+            const deg tthPix = angles_->tths[ind];
+            rgeTth_.extendBy(tthPix);
+            rgeGmaFull_.extendBy(gma);
             // TODO URGENT: THIS IS WRONG: seems correct only for tth<=90deg
-            if (dir.tth >= tth)
-                rgeGma_.extendBy(dir.gma); // gma range at mid tth
+            if (tthPix >= key_.midTth)
+                rgeGma_.extendBy(gma); // gma range at mid tth
         }
     }
-    //qDebug() << "AngleMap: found gamma range " << rgeGma_.to_s();
-    //qDebug() << "AngleMap: found full range " << rgeGmaFull_.to_s();
-    //qDebug() << "AngleMap: found theta range " << rgeTth_.to_s();
-
-    // compute indices of sorted gmas_:
-    std::vector<int> is(countAfterCut);
-    for (int i=0; i<is.size(); ++i)
-        is[i] = i;
-    //qDebug() << "AngleMap: sort";
-    // empirically, stable_sort seems to be faster than sort
-    std::stable_sort(is.begin(), is.end(), [this](int i1, int i2) {
-            return gmas_.at(i1) < gmas_.at(i2); });
-    //qDebug() << "AngleMap: sort/";
-    // sort gmas_:
-    std::vector<deg> gv(countAfterCut);
-    for (int i=0; i<countAfterCut; ++i)
-        gv[i] = gmas_.at(is.at(i));
-    gmas_ = std::move(gv);
-    // sort gmaIndexes_:
-    std::vector<int> uv(countAfterCut);
-    for (int i=0; i<countAfterCut; ++i)
-        uv[i] = gmaIndexes_.at(is.at(i));
-    gmaIndexes_ = std::move(uv);
-    //qDebug() << "AngleMap/";
+}
+
+//! Computes the gamma-sorted list of all pixels that are within the cut and not masked.
+void AngleMap::sortPixels()
+{
+    sortInCut(angles_->gmas, size_, cutOf(key_), gSession->detectorMask.excluded(),
+              rgeGmaFull_.min, rgeGmaFull_.max, gmas_, gmaIndexes_);
+}
+
+//! Takes the angles from an AngleMap that differs only in the cut, and updates its sorted
+//! gamma list. The result is the same as from sortPixels().
+
+void AngleMap::deriveFrom(const AngleMap& other)
+{
+    ASSERT(other.size_ == size_);
+    angles_ = other.angles_;
+    computeRanges();
+    deriveInCut(angles_->gmas, size_, cutOf(other.key_), cutOf(key_),
+                gSession->detectorMask.excluded(), other.gmas_, other.gmaIndexes_,
+                gmas_, gmaIndexes_);
+}
+
+//! Returns true if the pixel with the given index is within the cut.
+bool AngleMap::inCut(int ind) const
+{
+    return isInCut(ind, size_, cutOf(key_));
+}
+
+//! Returns true if gmas_ and gmaIndexes_ hold exactly the pixels that are within the cut and not
+//! masked, sorted by gamma and index, as computed by sortPixels() from the gammas allGmas.
+bool AngleMap::sortedPixelsValid(const std::vector<deg>& allGmas) const
+{
+    const std::vector<char>& excluded = gSession->detectorMask.excluded();
+    if (!excluded.empty() && excluded.size() != size_.count())
+        return false;
+    int expectedCount = 0;
+    for (int j = key_.cutTop, jEnd = size_.h - key_.cutBottom; j < jEnd; ++j)
+        for (int i = key_.cutLeft, iEnd = size_.w - key_.cutRight; i < iEnd; ++i)
+            if (excluded.empty() || !excluded[pointToIndex(i, j)])
+                ++expectedCount;
+    if (gmas_.size() != expectedCount || gmaIndexes_.size() != expectedCount)
+        return false;
+    for (int k=0; k<gmas_.size(); ++k) {
+        const int ind = gmaIndexes_[k];
+        if (ind < 0 || ind >= size_.count() || !inCut(ind)
+            || (!excluded.empty() && excluded[ind]) || gmas_[k] != allGmas[ind])
+            return false;
+        // strictly ascending in (gamma, index), hence without duplicates
+        if (k && (gmas_[k] < gmas_[k-1] || (gmas_[k] == gmas_[k-1] && ind <= gmaIndexes_[k-1])))
+            return false;
+    }
+    return true;
+}
+
+//! Reads angles and sorted gamma from a memory-mapped cache file, and computes the ranges.
+
+//! Returns false, and leaves the AngleMap unchanged, if the file does not exist, does not match
+//! the key, or is corrupt. If the angles are already shared from another AngleMap, they are
+//! not read again.
+
+bool AngleMap::readCache(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly) || file.size() < (qint64)sizeof(CacheHeader))
+        return false;
+    uchar* data = file.map(0, file.size());
+    if (!data)
+        return false;
+    CacheHeader h;
+    std::memcpy(&h, data, sizeof(h));
+    const qint64 n = qint64(h.w) * h.h;
+    const qint64 anglesSize = 2 * n * sizeof(deg);
+    const qint64 sortedSize = h.count * (sizeof(deg) + sizeof(int));
+    const uchar* p = data + sizeof(CacheHeader);
+    if (!headerMatches(h, key_) || h.count < 0 || h.count > n
+        || file.size() != qint64(sizeof(CacheHeader)) + anglesSize + sortedSize
+        || checksum(checksumSeed, p, anglesSize + sortedSize) != h.checksum) {
+        file.unmap(data);
+        qWarning() << "Ignoring invalid angle map cache " << path;
+        return false;
+    }
+    auto readArray = [&p](auto& vec, qint64 size) {
+        vec.resize(size);
+        std::memcpy(vec.data(), p, size * sizeof(vec[0]));
+        p += size * sizeof(vec[0]);
+    };
+    std::shared_ptr<const PixelAngles> angles = angles_;
+    if (angles) {
+        p += anglesSize;
+    } else {
+        std::shared_ptr<PixelAngles> read(new PixelAngles);
+        readArray(read->tths, n);
+        readArray(read->gmas, n);
+        angles = read;
+    }
+    std::vector<deg> gmas;
+    std::vector<int> gmaIndexes;
+    readArray(gmas, h.count);
+    readArray(gmaIndexes, h.count);
+    file.unmap(data);
+    file.close();
+    gmas_.swap(gmas);
+    gmaIndexes_.swap(gmaIndexes);
+    if (!sortedPixelsValid(angles->gmas)) {
+        qWarning() << "Ignoring corrupt angle map cache " << path;
+        gmas_.swap(gmas);
+        gmaIndexes_.swap(gmaIndexes);
+        return false;
+    }
+    angles_ = angles;
+    computeRanges();
+    cache_dir::markUsed(path);
+    return true;
+}
+
+//! Writes angles and sorted gamma to a cache file, to be reused in later sessions;
+//! then removes the least recently used cache files if the budget is exceeded.
+void AngleMap::writeCache(const QString& path) const
+{
+    CacheHeader h = headerFromKey(key_);
+    h.count = gmas_.size();
+    const std::vector<deg>& tths = angles_->tths;
+    const std::vector<deg>& gmasAll = angles_->gmas;
+    quint64 sum = checksumSeed;
+    sum = checksum(sum, tths.data(), tths.size() * sizeof(deg));
+    sum = checksum(sum, gmasAll.data(), gmasAll.size() * sizeof(deg));
+    sum = checksum(sum, gmas_.data(), gmas_.size() * sizeof(deg));
+    h.checksum = checksum(sum, gmaIndexes_.data(), gmaIndexes_.size() * sizeof(int));
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot write angle map cache " << path;
+        return;
+    }
+    file.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    file.write(reinterpret_cast<const char*>(tths.data()), tths.size() * sizeof(deg));
+    file.write(reinterpret_cast<const char*>(gmasAll.data()), gmasAll.size() * sizeof(deg));
+    file.write(reinterpret_cast<const char*>(gmas_.data()), gmas_.size() * sizeof(deg));
+    file.write(reinterpret_cast<const char*>(gmaIndexes_.data()), gmaIndexes_.size() * sizeof(int));
+    if (!file.commit()) {
+        qWarning() << "Cannot write angle map cache " << path;
+        return;
+    }
+    cache_dir::trim("anglemaps", cacheBudget);
 }
 
 void AngleMap::getGmaIndexes(
     const Range& rgeGma, const std::vector<int>*& indexes, int& minIndex, int& maxIndex) const
 {
     indexes = &gmaIndexes_;
+    if (gmas_.empty()) { // all pixels masked
+        minIndex = maxIndex = 0;
+        return;
+    }
     minIndex = lowerBound(gmas_, rgeGma.min, 0, gmas_.size());
     maxIndex = upperBound(gmas_, rgeGma.max, 0, gmas_.size());
 }
 
+//! Returns the approximate memory footprint, including cached projection tables, in bytes.
+size_t AngleMap::memSize() const
+{
+    size_t ret = sizeof(*this)
+        + angles_->tths.capacity() * sizeof(deg) // counted fully, though possibly shared
+        + angles_->gmas.capacity() * sizeof(deg)
+        + gmas_.capacity() * sizeof(deg)
+        + gmaIndexes_.capacity() * sizeof(int);
+    for (const auto& table : tables_)
+        ret += table->memSize();
+    return ret;
+}
+
+//! Returns a cached ProjectionTable for the given gamma slices and 2theta bins;
+//! computes it if needed.
+const ProjectionTable& AngleMap::projectionTable(
+    const Range& rgeGma, int numSlices, bool exclusive,
+    deg minTth, deg deltaTth, int numBins) const
+{
+    static const int maxTables = 8;
+    for (auto it = tables_.begin(); it != tables_.end(); ++it) {
+        if ((*it)->matches(rgeGma, numSlices, exclusive, minTth, deltaTth, numBins)) {
+            std::rotate(it, it + 1, tables_.end()); // move to back, keeping the others in order
+            return *tables_.back();
+        }
+    }
+    if (tables_.size() >= maxTables)
+        tables_.erase(tables_.begin()); // drop least recently used
+    tables_.emplace_back(
+        new ProjectionTable(*this, rgeGma, numSlices, exclusive, minTth, deltaTth, numBins));
+    return *tables_.back();
+}
+
 #endif // LOCAL_CODE_ONLY
@@ -16,9 +16,11 @@
 #define ANGLE_MAP_H
 
 #include "core/base/angles.h"
+#include "core/data/projection_table.h"
 #include "core/typ/range.h"
 #include "core/typ/size2d.h"
 #include <QSharedPointer> // no auto rm
+#include <memory>
 
 //! A pair of angles (gamma, 2theta) that designate a scattering direction.
 class ScatterDirection {
@@ -30,30 +32,82 @@ public:
     deg gma;
 };
 
+//! The parameters that determine an AngleMap.
+
+//! Implicitly constructible from the mid 2theta angle, taking all other parameters
+//! from the current session. The detector mask is represented by its hash only;
+//! AngleMap takes the mask itself from the session.
+
+class AngleMapKey {
+public:
+    AngleMapKey(deg midTth);
+
+    bool operator==(const AngleMapKey&) const;
+    bool operator!=(const AngleMapKey& other) const { return !(*this==other); }
+
+    deg midTth;
+    size2d imageSize;
+    double detectorDistance;
+    double pixSize;
+    int pixOffsetX, pixOffsetY;
+    int cutLeft, cutRight, cutTop, cutBottom;
+    QByteArray maskHash; //!< DetectorMask::hash()
+};
+
 //! Holds (gamma, 2theta) for all pixels in a detector image, and caches sorted gamma values.
 
+//! The angles do not depend on image cut and mask; they are shared by all AngleMaps
+//! that differ only in these. When the cut changes, the new AngleMap is derived from
+//! one with the old cut: pixels of the strips cut away are dropped from the sorted gamma
+//! list, and pixels of the strips uncovered are merged in.
+
 class AngleMap {
 public:
     AngleMap() = delete;
-    AngleMap(const deg tth);
+    AngleMap(const AngleMapKey& key);
+    AngleMap(const AngleMap&) = delete;
+    ~AngleMap();
 
-    const ScatterDirection& dirAt1(int i) const { return arrAngles_[i]; }
-    const ScatterDirection& dirAt2(int ix, int iy) const { return dirAt1(pointToIndex(ix, iy)); }
+    ScatterDirection dirAt1(int i) const { return {angles_->tths[i], angles_->gmas[i]}; }
+    ScatterDirection dirAt2(int ix, int iy) const { return dirAt1(pointToIndex(ix, iy)); }
+    deg tthAt1(int i) const { return angles_->tths[i]; }
+    deg gmaAt1(int i) const { return angles_->gmas[i]; }
 
     Range rgeTth() const { return rgeTth_; }
     Range rgeGma() const { return rgeGma_; }
     Range rgeGmaFull() const { return rgeGmaFull_; }
 
     void getGmaIndexes(const Range&, const std::vector<int>*&, int&, int&) const;
+    const ProjectionTable& projectionTable(
+        const Range& rgeGma, int numSlices, bool exclusive,
+        deg minTth, deg deltaTth, int numBins) const;
+
+    size_t memSize() const;
 
 private:
+    struct PixelAngles {
+        std::vector<deg> tths; //!< 2theta of all pixels, row-major
+        std::vector<deg> gmas; //!< gamma of all pixels, row-major
+    };
+
+    void computeAngles();
+    void computeRanges();
+    void sortPixels();
+    void deriveFrom(const AngleMap& other);
+    bool inCut(int ind) const;
+    bool sortedPixelsValid(const std::vector<deg>& allGmas) const;
+    bool readCache(const QString& path);
+    void writeCache(const QString& path) const;
+
+    const AngleMapKey key_;
     size2d size_;
-    std::vector<ScatterDirection> arrAngles_;
+    std::shared_ptr<const PixelAngles> angles_;
 
     Range rgeTth_;
     Range rgeGma_, rgeGmaFull_;
     std::vector<deg> gmas_; //!< sorted gamma values
     std::vector<int> gmaIndexes_;
+    mutable std::vector<std::unique_ptr<ProjectionTable>> tables_; //!< most recently used last
 
     int pointToIndex(int ix, int iy) const { return iy * size_.w + ix; }
 };
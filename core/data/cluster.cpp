@@ -134,8 +134,7 @@ double Sequence::normFactor() const
 namespace {
 Dfgram computeSectorDfgram(const int jS, const Cluster* const parent)
 {
-    int nS = gSession->gammaSelection.numSlices.val();
-    return Dfgram(algo::projectCluster(*parent, parent->rangeGma().slice(jS,nS)));
+    return Dfgram(algo::histogramToCurve(parent->sliceHistogram(jS), parent->normFactor()));
 }
 } //namespace
 
@@ -146,12 +145,30 @@ Cluster::Cluster(
     , dfgrams {[]()->int{return gSession->gammaSelection.numSlices.val();},
                [](int jS, const Cluster* parent)->Dfgram{
                    return computeSectorDfgram(jS, parent); }}
+    , sliceHistograms_ {[](const Cluster* parent)->std::vector<Histogram>{
+            return algo::projectSlices(*parent, parent->rangeGma(),
+                                       gSession->gammaSelection.numSlices.val(), false); }}
+    , gammaCube_ {[](const Cluster* parent)->GammaCube{
+            const Range rgeGma = parent->rangeGmaFull();
+            const int numBins = gSession->gammaSelection.numFineBins.val();
+            return {rgeGma, algo::projectSlices(*parent, rgeGma, numBins, true)}; }}
     , file_{file}
     , index_ {index}
     , offset_ {offset}
     , selected_ {true}
 {}
 
+//! Takes over the raw intensities computed by other, which must have the same members.
+
+//! Used when clusters are remade, so that unchanged clusters need not be projected again.
+
+void Cluster::adoptProjections(const Cluster& other)
+{
+    ASSERT(other.members() == members());
+    sliceHistograms_.adopt(other.sliceHistograms_);
+    gammaCube_.adopt(other.gammaCube_);
+}
+
 int Cluster::totalOffset() const
 {
     return file_.offset_ + offset();
@@ -167,6 +184,40 @@ const Dfgram& Cluster::currentDfgram() const
     return dfgrams.yield_at(gSession->gammaSelection.currSlice.val()-1, this);
 }
 
+//! Returns the raw intensities in gamma section jS.
+Histogram Cluster::sliceHistogram(int jS) const
+{
+    const GammaSelection& gs = gSession->gammaSelection;
+    const int numFineBins = gs.numFineBins.val();
+    if (const GammaCube* cube = gammaCube_.current())
+        if (cube->numGmaBins() != numFineBins)
+            gammaCube_.invalidate();
+    if (numFineBins > 0) {
+        const int nS = gs.numSlices.val();
+        const Range rgeGma = rangeGma();
+        return gammaCube_.yield(this).histogram(nS==1 ? rgeGma : rgeGma.slice(jS, nS));
+    }
+
+    const std::vector<Histogram>* current = sliceHistograms_.current();
+    if (current && current->size()!=gs.numSlices.val())
+        sliceHistograms_.invalidate();
+    return sliceHistograms_.yield(this).at(jS);
+}
+
+//! Discards all diffractograms, and the raw intensities per gamma section.
+void Cluster::invalidateSlices() const
+{
+    dfgrams.clear_vector();
+    sliceHistograms_.invalidate();
+}
+
+//! Discards all diffractograms, and all raw intensities they are computed from.
+void Cluster::invalidateDfgrams() const
+{
+    invalidateSlices();
+    gammaCube_.invalidate();
+}
+
 bool Cluster::isActive() const
 {
     return file_.activated() && selected_;
@@ -16,7 +16,9 @@
 #define CLUSTER_H
 
 #include "core/data/dfgram.h"
+#include "core/data/gamma_cube.h"
 #include "core/raw/measurement.h"
+#include "core/typ/histogram.h"
 #include "core/typ/lazy_data.h"
 
 //! A group of one or more `Measurement`s.
@@ -73,6 +75,7 @@ public:
     Cluster(const Cluster&) = delete;
 
     void setSelected(bool on) { selected_ = on; }
+    void adoptProjections(const Cluster& other);
 
     const class Datafile& file() const { return file_; }
     int index() const { return index_; }
@@ -85,8 +88,16 @@ public:
 
     mutable lazy_data::VectorCache<Dfgram,const Cluster*> dfgrams; //! One Dfgram per gamma section
     const Dfgram& currentDfgram() const;
+    Histogram sliceHistogram(int jS) const;
+    void invalidateSlices() const;
+    void invalidateDfgrams() const;
 
 private:
+    //! Raw intensities of all gamma sections, computed together in one sweep through the images
+    mutable lazy_data::Cached<std::vector<Histogram>,const Cluster*> sliceHistograms_;
+    //! Raw intensities in fine gamma bins, used instead of sliceHistograms_ if requested
+    mutable lazy_data::Cached<GammaCube,const Cluster*> gammaCube_;
+
     const class Datafile& file_;
     const int index_; //!< index in total list of `Cluster`s
     const int offset_; //!< index of first Measurement in file_
@@ -13,57 +13,127 @@
 //  ***********************************************************************************************
 
 #include "core/data/collect_intensities.h"
+#include "core/base/parallel.h"
 #include "core/session.h"
+#include "core/typ/histogram.h"
 #include "qcr/base/debug.h"
 #include <qmath.h>
+#include <functional>
 
 namespace {
 
-//! Increments intens and counts.
-void projectMeasurement(
-    std::vector<float>& intens, std::vector<int>& counts,
-    const Measurement& measurement, const Range& rgeGma, deg minTth, deg deltaTth)
-{
-    const AngleMap& angleMap = gSession->angleMap.get(measurement.midTth());
-
-    const std::vector<int>* gmaIndexes = nullptr;
-    int gmaIndexMin = 0, gmaIndexMax = 0;
-    angleMap.getGmaIndexes(rgeGma, gmaIndexes, gmaIndexMin, gmaIndexMax);
+//! Returns the image of member m; the result keeps a lazily loaded image in memory while held.
+using ImageSource = std::function<std::shared_ptr<const Image>(int m)>;
 
-    ASSERT(gmaIndexes);
-    ASSERT(gmaIndexMin <= gmaIndexMax);
-    ASSERT(gmaIndexMax <= gmaIndexes->size());
+//! Increments the bins [iBegin,iEnd) of hists by the intensities of one sparse image.
 
-    ASSERT(intens.size() == counts.size());
-    int count = intens.size();
+//! All pixels in the table are counted as if they were zero, then nonzero pixels are added.
 
-    ASSERT(deltaTth > 0);
+void projectSparseMeasurement(
+    std::vector<Histogram>& hists, const Image& image, const ProjectionTable& table,
+    const Image* normalizer, int iBegin, int iEnd)
+{
+    ASSERT(image.isSparse());
+    table.prepareSparse();
+    const int numBins = table.numBins();
+    const std::vector<int>& binStart = table.binStart();
+    for (int i=iBegin; i<iEnd; ++i)
+        hists[i / numBins].counts[i % numBins] += binStart[i+1] - binStart[i];
+
+    const std::vector<int>& pixelStart = table.pixelStart();
+    const std::vector<int>& pixelBins = table.pixelBins();
+    ASSERT(!pixelStart.empty());
+    const int numPixels = pixelStart.size() - 1;
+    const std::vector<int>& indexes = image.sparseIndexes();
+    const std::vector<float>& intens = image.sparseIntens();
+    for (int k=0; k<indexes.size(); ++k) {
+        const int ind = indexes[k];
+        if (ind >= numPixels)
+            break;
+        float inten = intens[k];
+        if (normalizer)
+            inten *= normalizer->inten1d(ind);
+        for (int l=pixelStart[ind]; l<pixelStart[ind+1]; ++l) {
+            const int i = pixelBins[l];
+            if (i < iBegin || i >= iEnd)
+                continue;
+            Histogram& hist = hists[i / numBins];
+            if (qIsNaN(inten))
+                --hist.counts[i % numBins];
+            else
+                hist.intens[i % numBins] += inten;
+        }
+    }
+}
 
-    const Image& normalizer = gSession->corrset.getNormalizer();
-    const bool isNormalizerEnabled = gSession->corrset.isEnabledAndValid();
+//! Increments the bins [iBegin,iEnd) of hists by the intensities of one image.
 
-    // TODO: MOST TIME IS SPENT HERE => OPTIMIZE !
-    for (int i = gmaIndexMin; i < gmaIndexMax; ++i) {
-        int ind = gmaIndexes->at(i);
-        float inten = measurement.image().inten1d(ind);
-        if (qIsNaN(inten))
-            continue;
+//! Bins are counted through all slices, i = jS*numBins + ti, as in ProjectionTable.
 
-        if (isNormalizerEnabled) {
-            float corr = normalizer.inten1d(ind);
-            if (qIsNaN(corr)) // TODO: correct handling of corr=0
+void projectMeasurement(
+    std::vector<Histogram>& hists, const Image& image, const ProjectionTable& table,
+    const Image* normalizer, int iBegin, int iEnd)
+{
+    ASSERT(hists.size() == table.numSlices());
+    if (image.isSparse())
+        return projectSparseMeasurement(hists, image, table, normalizer, iBegin, iEnd);
+    const int numBins = table.numBins();
+
+    const std::vector<int>& binStart = table.binStart();
+    const std::vector<int>& pixels = table.pixels();
+
+    for (int i=iBegin; i<iEnd; ++i) {
+        double sum = 0;
+        int cnt = 0;
+        for (int k=binStart[i], kEnd=binStart[i+1]; k<kEnd; ++k) {
+            const int ind = pixels[k];
+            float inten = image.inten1d(ind);
+            if (normalizer)
+                inten *= normalizer->inten1d(ind); // invalid pixels are masked, see DetectorMask
+            if (qIsNaN(inten))
                 continue;
-            inten *= corr;
+            sum += inten;
+            ++cnt;
         }
+        Histogram& hist = hists[i / numBins];
+        hist.intens[i % numBins] += sum;
+        hist.counts[i % numBins] += cnt;
+    }
+}
 
-        // bin index
-        deg tth = angleMap.dirAt1(ind).tth;
-        int ti = qFloor((tth - minTth) / deltaTth);
-        ASSERT(ti <= count);
-        ti = qMin(ti, count - 1); // it can overshoot due to floating point calculation
+//! Increments hists by the intensities of images [mBegin,mEnd), which share one table.
 
-        intens[ti] += inten;
-        counts[ti] += 1;
+//! Work is distributed over threads: by measurements, each thread filling private
+//! histograms, if there are enough of them, otherwise by bins. Each image is obtained
+//! just before it is projected, and dropped right after, so that lazily loaded images
+//! are loaded by the worker threads, and at most one per thread is held in memory.
+
+void projectRun(
+    std::vector<Histogram>& hists, const ImageSource& imageOf,
+    int mBegin, int mEnd, const ProjectionTable& table, const Image* normalizer)
+{
+    const int numMembers = mEnd - mBegin;
+    const int numAllBins = table.numSlices() * table.numBins();
+    if (numMembers >= parallel::numThreads()) {
+        std::vector<std::vector<Histogram>> partial(parallel::numChunks(numMembers));
+        for (std::vector<Histogram>& one : partial)
+            for (const Histogram& hist : hists)
+                one.emplace_back(hist.xMin, hist.dx, hist.size());
+        parallel::forChunks(numMembers, [&](int iChunk, int begin, int end) {
+                for (int m=begin; m<end; ++m)
+                    projectMeasurement(partial[iChunk], *imageOf(mBegin+m), table, normalizer,
+                                       0, numAllBins);
+            });
+        for (const std::vector<Histogram>& one : partial)
+            for (int jS=0; jS<hists.size(); ++jS)
+                hists[jS].add(one[jS]);
+    } else {
+        for (int m=mBegin; m<mEnd; ++m) {
+            const std::shared_ptr<const Image> image = imageOf(m);
+            parallel::forChunks(numAllBins, [&](int, int iBegin, int iEnd) {
+                    projectMeasurement(hists, *image, table, normalizer, iBegin, iEnd);
+                });
+        }
     }
 }
 
@@ -81,37 +151,103 @@ int algo::numTthBins(const std::vector<const Measurement*>& _members, const Rang
     return ret;
 }
 
-//! Computes and returns diffractogram for given image cluster and gamma range.
+//! Computes raw intensity histograms for numSlices equal slices of the given gamma range.
 
-Curve algo::projectCluster(const Sequence& cluster, const Range& rgeGma)
+//! All slices are filled in one sweep through each image.
+//! If exclusive is set, pixels on slice boundaries are counted only once, see ProjectionTable.
+//! If the HistogramCache is enabled, members are projected one by one, and their histograms
+//! are cached; members found in the cache are not projected again.
+
+std::vector<Histogram> algo::projectSlices(
+    const Sequence& cluster, const Range& rgeGma, int numSlices, bool exclusive)
 {
+    ASSERT(numSlices > 0);
     const std::vector<const Measurement*>& members = cluster.members();
-    double normFactor = cluster.normFactor();
     const Range& rgeTth = cluster.rangeTth();
 
-    int numBins = numTthBins(members, rgeTth);
-    std::vector<float> intens(numBins, 0);
-    std::vector<int> counts(numBins, 0);
-
-    deg minTth = rgeTth.min;
-    deg deltaTth = rgeTth.width() / numBins;
-
-    for (const Measurement* one : members)
-        // increment intens and counts
-        projectMeasurement(intens, counts, *one, rgeGma, minTth, deltaTth);
+    const int numBins = numTthBins(members, rgeTth);
+    const deg minTth = rgeTth.min;
+    const deg deltaTth = rgeTth.width() / numBins;
+    std::vector<Histogram> ret(numSlices, Histogram(minTth, deltaTth, numBins));
+
+    // Lazy data (normalizer, corrected images, angle maps, tables) are computed here,
+    // in the calling thread; only the projection itself is done in parallel.
+    const Corrset& corrset = gSession->corrset;
+    const bool useCorrected = corrset.useCorrectedImages();
+    const Image* normalizer =
+        !useCorrected && corrset.isEnabledAndValid() ? &corrset.getNormalizer() : nullptr;
+
+    // members that need to be projected
+    HistogramCache& cache = gSession->memberHistograms;
+    const bool useCache = cache.enabled.val();
+    const HistogramCache::Key key {rgeGma, numSlices, exclusive, minTth, deltaTth, numBins,
+            corrset.isEnabledAndValid() ? corrset.generation() : -1};
+    std::vector<const Measurement*> todo;
+    for (const Measurement* m : members) {
+        const std::vector<Histogram>* cached = useCache ? cache.find(m, key) : nullptr;
+        if (!cached) {
+            todo.push_back(m);
+            continue;
+        }
+        for (int jS=0; jS<numSlices; ++jS)
+            ret[jS].add((*cached)[jS]);
+    }
 
-    // sum or average
-    if (gSession->params.intenScaledAvg.val()) {
-        double scale = gSession->params.intenScale.val();
-        for (int i=0; i<numBins; ++i) {
-            int cnt = counts.at(i);
-            if (cnt > 0)
-                intens[i] *= scale / cnt;
+    // Corrected images are lazy data, and therefore computed here. Raw images are obtained
+    // in projectRun, so that lazily loaded ones need not all be in memory at the same time.
+    std::vector<const Image*> corrected;
+    if (useCorrected)
+        for (const Measurement* m : todo)
+            corrected.push_back(&corrset.correctedImage(*m));
+    const ImageSource imageOf = [&](int m)->std::shared_ptr<const Image> {
+        if (useCorrected) // held by the Measurement; not owned by the result
+            return std::shared_ptr<const Image>(std::shared_ptr<const Image>(), corrected[m]);
+        return todo[m]->image(); };
+
+    // increment histograms, by runs of consecutive members that have the same midTth
+    for (int mBegin=0, mEnd=0; mBegin<todo.size(); mBegin=mEnd) {
+        const deg midTth = todo[mBegin]->midTth();
+        for (mEnd=mBegin+1; mEnd<todo.size(); ++mEnd)
+            if (todo[mEnd]->midTth() != midTth)
+                break;
+        // valid until the next angleMap.get(), which is not called before the next run
+        const ProjectionTable& table = gSession->angleMap.get(midTth).projectionTable(
+            rgeGma, numSlices, exclusive, minTth, deltaTth, numBins);
+        if (!useCache) {
+            projectRun(ret, imageOf, mBegin, mEnd, table, normalizer);
+            continue;
+        }
+        for (int m=mBegin; m<mEnd; ++m) {
+            std::vector<Histogram> one(numSlices, Histogram(minTth, deltaTth, numBins));
+            projectRun(one, imageOf, m, m+1, table, normalizer);
+            for (int jS=0; jS<numSlices; ++jS)
+                ret[jS].add(one[jS]);
+            cache.insert(todo[m], key, std::move(one));
         }
     }
+    return ret;
+}
 
+//! Converts a raw intensity histogram into a diffractogram, applying averaging and normalization.
+
+Curve algo::histogramToCurve(const Histogram& hist, double normFactor)
+{
+    const bool average = gSession->params.intenScaledAvg.val();
+    const double scale = gSession->params.intenScale.val();
     Curve ret;
-    for (int i=0; i<numBins; ++i)
-        ret.append(minTth + deltaTth * i, double(intens.at(i) * normFactor));
+    for (int i=0; i<hist.size(); ++i) {
+        double inten = hist.intens.at(i);
+        const int cnt = hist.counts.at(i);
+        if (average && cnt > 0)
+            inten *= scale / cnt;
+        ret.append(hist.x(i), inten * normFactor);
+    }
     return ret;
 }
+
+//! Computes and returns diffractogram for given image cluster and gamma range.
+
+Curve algo::projectCluster(const Sequence& cluster, const Range& rgeGma)
+{
+    return histogramToCurve(projectSlices(cluster, rgeGma, 1, false).front(), cluster.normFactor());
+}
@@ -18,6 +18,7 @@
 #include <vector> // no auto rm
 
 class Curve;
+class Histogram;
 class Measurement;
 class Range;
 class Sequence;
@@ -28,6 +29,9 @@ class Sequence;
 namespace algo {
 
 int numTthBins(const std::vector<const Measurement*>&, const Range&);
+std::vector<Histogram> projectSlices(
+    const Sequence&, const Range& rgeGma, int numSlices, bool exclusive);
+Curve histogramToCurve(const Histogram&, double normFactor);
 Curve projectCluster(const Sequence&, const Range&);
 
 } // namespace algo
@@ -33,18 +33,21 @@ Image recomputeNormalizer(const Image& corrImage)
     int h = size.h;
     int di = gSession->params.imageCut.left.val();
     int dj = gSession->params.imageCut.top .val();
+    // per-pixel access to a sparse image would take a binary search for each pixel
+    const std::vector<float> intens = corrImage.denseIntens();
+    const int fullW = corrImage.size().w;
 
     double sum = 0;
     for (int i=0; i<w; ++i)
         for (int j=0; j<h; ++j)
-            sum += corrImage.inten2d(i + di, j + dj);
+            sum += intens[(j + dj) * fullW + i + di];
     double avg = sum / (w * h);
 
     Image ret(corrImage.size(), 1.);
 
     for (int i=0; i<w; ++i) {
         for (int j=0; j<h; ++j) {
-            const float inten = corrImage.inten2d(i + di, j + dj);
+            const float inten = intens[(j + dj) * fullW + i + di];
             double fact;
             if (inten > 0) {
                 fact = avg / inten;
@@ -63,7 +66,34 @@ Image recomputeNormalizer(const Image& corrImage)
 Corrset::Corrset()
     : normalizer_{[this]()->Image{ return recomputeNormalizer(image()); }}
 {
-    enabled.setHook([](const bool){ gSession->onNormalization(); });
+    enabled.setHook([](const bool){
+        gSession->detectorMask.invalidate();
+        gSession->onCorrection(); });
+    keepCorrected.setHook([this](const bool on){
+        if (!on)
+            releaseCorrectedImages(); });
+}
+
+void Corrset::invalidateNormalizer() const
+{
+    normalizer_.invalidate();
+    gSession->detectorMask.invalidate();
+    ++generation_;
+    releaseCorrectedImages();
+}
+
+//! Returns the image of the given Measurement times the normalizer; cached in the Measurement.
+const Image& Corrset::correctedImage(const Measurement& measurement) const
+{
+    return measurement.correctedImage(getNormalizer(), generation_);
+}
+
+//! Frees the corrected images of all Measurements in the session.
+void Corrset::releaseCorrectedImages() const
+{
+    for (auto const& cluster: gSession->dataset.allClusters)
+        for (const Measurement* m : cluster->members())
+            m->releaseCorrectedImage();
 }
 
 void Corrset::clear()
@@ -92,7 +122,7 @@ void Corrset::loadFile(const QString& filePath)
     invalidateNormalizer();
     // all ok
     enabled.setVal(true);
-    gSession->onNormalization();
+    gSession->onCorrection();
     gRoot->remakeAll();
 }
 
@@ -102,6 +132,7 @@ QJsonObject Corrset::toJson() const
     if (hasFile())
         ret.insert("file", raw_->fileInfo().absoluteFilePath());
     ret.insert("enabled", enabled.val());
+    ret.insert("keep corrected images", keepCorrected.val());
     return ret;
 }
 
@@ -110,4 +141,5 @@ void Corrset::fromJson(const JsonObj& obj)
     if (obj.find("file") != obj.end())
         loadFile(obj.loadString("file"));
     enabled.setVal(obj.loadBool("enabled", false));
+    keepCorrected.setVal(obj.loadBool("keep corrected images", false));
 }
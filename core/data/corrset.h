@@ -40,16 +40,23 @@ public:
     bool hasFile() const { return raw_.get(); }
     QString fileName() const { return hasFile() ? raw_->fileName() : ""; }
     const Image& image() const { return corrImage_; }
-    void invalidateNormalizer() const { normalizer_.invalidate(); }
+    void invalidateNormalizer() const;
     const Image& getNormalizer() const { return normalizer_.yield(); }
+    int generation() const { return generation_; } //!< changes whenever the normalizer does
     bool isEnabledAndValid() const { return enabled.val() && !getNormalizer().size().isEmpty(); }
+    bool useCorrectedImages() const { return keepCorrected.val() && isEnabledAndValid(); }
+    const Image& correctedImage(const Measurement&) const;
 
     QcrCell<bool> enabled {false};
+    QcrCell<bool> keepCorrected {false}; //!< cache corrected images; faster, but needs more memory
 
 private:
     std::unique_ptr<const Rawfile> raw_; //!< owned by this
     Image corrImage_;
     mutable lazy_data::Cached<Image> normalizer_;
+    mutable int generation_ {0}; //!< incremented whenever normalizer_ is invalidated
+
+    void releaseCorrectedImages() const;
 };
 
 #endif // CORRSET_H
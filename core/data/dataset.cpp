@@ -12,12 +12,15 @@
 //
 //  ***********************************************************************************************
 
+#include "core/base/parallel.h"
 #include "core/data/cluster.h"
 #include "core/loaders/loaders.h"
 #include "core/session.h"
 #include "qcr/engine/mixin.h" // remakeAll
 #include "qcr/base/debug.h" // ASSERT
 #include <algorithm>
+#include <exception>
+#include <memory>
 
 //  ***********************************************************************************************
 //! @class Datafile
@@ -105,6 +108,10 @@ void Dataset::clear()
     //qDebug() << "Dataset::clear";
     highlight_.clear();
     files_.clear();
+    gSession->memberHistograms.clear();
+    gSession->imagePool.clear();
+    gSession->framePool.clear();
+    scratch_.reset(); // the scratch file is deleted once the last image using it is gone
     onFileChanged();
     gSession->updateImageSize();
     gSession->params.imageCut.clear();
@@ -119,6 +126,7 @@ void Dataset::removeFile()
         return;
     int i = cluster->file().index();
     files_.erase(files_.begin()+i);
+    gSession->memberHistograms.clear(); // keyed by Measurement addresses, which may be reused
     if (files_.empty())
         return clear();
     onFileChanged();
@@ -138,13 +146,48 @@ void Dataset::addGivenFiles(const QStringList& filePaths)
     if (const Cluster* cluster = highlight_.cluster())
         i = cluster->file().index();
     highlight_.clear();
-    for (const QString& path: filePaths) {
-        if (path.isEmpty() || hasFile(path))
-            continue;
-        Rawfile rawfile { load::loadRawfile(path) };
-        gSession->setImageSize(rawfile.imageSize());
-        files_.push_back(Datafile {std::move(rawfile)});
-        onFileChanged();
+    QStringList newPaths;
+    for (const QString& path: filePaths)
+        if (!path.isEmpty() && !hasFile(path) && !newPaths.contains(path))
+            newPaths.push_back(path);
+
+    // The loaders do not touch the session, so files can be loaded concurrently.
+    ImagePool* pool = lazyImages.val() ? &gSession->imagePool : nullptr;
+    if (scratchImages.val() && !scratch_)
+        scratch_ = std::make_shared<ScratchFileStore>();
+    ImageStorage storage;
+    if (scratchImages.val())
+        storage.store = scratch_;
+    if (compressImages.val())
+        storage.framePool = &gSession->framePool;
+    load::RawfileCacheSettings cache;
+    cache.enabled = cacheRawfiles.val();
+    cache.compressed = compressRawfileCache.val();
+    const int n = newPaths.size();
+    std::vector<std::unique_ptr<Rawfile>> rawfiles(n);
+    std::vector<std::exception_ptr> failures(n);
+    parallel::forChunks(n, [&](int, int begin, int end) {
+        for (int k=begin; k<end; ++k) {
+            try {
+                rawfiles[k].reset(new Rawfile {load::loadRawfile(newPaths[k], pool, storage, cache)});
+            } catch (...) {
+                failures[k] = std::current_exception();
+            }
+        }
+    });
+
+    // Insert in the original order; stop at the first file that failed to load.
+    for (int k=0; k<n; ++k) {
+        try {
+            if (failures[k])
+                std::rethrow_exception(failures[k]);
+            gSession->setImageSize(rawfiles[k]->imageSize());
+        } catch (...) {
+            onFileChanged();
+            throw;
+        }
+        files_.push_back(Datafile {std::move(*rawfiles[k])});
+        rawfiles[k].reset();
     }
     if (countFiles())
         highlight_.setFile( i<0 ? 0 : i );
@@ -177,16 +220,22 @@ void Dataset::onClusteringChanged()
     highlight_.reset();
 }
 
+//! Remakes all clusters. Clusters with unchanged members keep their projected intensities.
 void Dataset::updateClusters()
 {
+    // The old clusters are kept alive until the new ones have adopted their projections.
+    const std::vector<std::unique_ptr<Cluster>> oldClusters = std::move(allClusters);
     allClusters.clear();
     hasIncomplete_ = false;
     int measureNum = 1;
     double measureTime =0;
     int clusterOffset = 0;
     for (Datafile& file : files_) {
+        const std::vector<Cluster*> oldOfFile = std::move(file.clusters_); // ordered by offset
+        auto old = oldOfFile.begin();
         file.clusters_.clear();
         file.clusterOffset_ = clusterOffset;
+        const std::vector<const Measurement*> measurements = file.raw_.measurements();
         for (int i=0; i<file.numMeasurements(); i+=binning.val()) {
             if (i+binning.val()>file.numMeasurements()) {
                 hasIncomplete_ = true;
@@ -197,11 +246,15 @@ void Dataset::updateClusters()
             for (int ii=i; ii<file.numMeasurements() && ii<i+binning.val(); ii++) {
                 file.raw_.setMeasurementNum(ii, measureNum);
                 file.raw_.setMeasurementTime(ii, measureTime);
-                measureTime += file.raw_.measurements().at(ii)->deltaTime();
-                group.push_back(file.raw_.measurements().at(ii));
+                measureTime += measurements[ii]->deltaTime();
+                group.push_back(measurements[ii]);
                 measureNum++;
             }
             std::unique_ptr<Cluster> cluster(new Cluster(group, file, allClusters.size(), i));
+            while (old != oldOfFile.end() && (*old)->offset() < i)
+                ++old;
+            if (old != oldOfFile.end() && (*old)->offset() == i && (*old)->members() == group)
+                cluster->adoptProjections(**old);
             file.clusters_.push_back(cluster.get());
             allClusters.push_back(std::move(cluster));
             clusterOffset++;
@@ -231,6 +284,11 @@ QJsonObject Dataset::toJson() const
         arr.append(file.raw_.fileInfo().absoluteFilePath());
     ret.insert("files", arr);
     ret.insert("binning", binning.val());
+    ret.insert("lazy images", lazyImages.val());
+    ret.insert("scratch file images", scratchImages.val());
+    ret.insert("compressed images", compressImages.val());
+    ret.insert("cache raw files", cacheRawfiles.val());
+    ret.insert("compress raw file cache", compressRawfileCache.val());
     return ret;
 }
 
@@ -240,6 +298,11 @@ void Dataset::fromJson(const JsonObj& obj)
     QStringList paths;
     for (const QJsonValue& file : files)
         paths.append(file.toString());
+    lazyImages.setVal(obj.loadBool("lazy images", false));
+    scratchImages.setVal(obj.loadBool("scratch file images", false));
+    compressImages.setVal(obj.loadBool("compressed images", false));
+    cacheRawfiles.setVal(obj.loadBool("cache raw files", false));
+    compressRawfileCache.setVal(obj.loadBool("compress raw file cache", false));
     addGivenFiles(paths);
     binning.setVal(obj.loadPint("binning", 1));
 }
@@ -103,6 +103,11 @@ public:
 
     QcrCell<int> binning {1};             //!< bin so many `Measurement`s into one cluster
     QcrCell<bool> dropIncomplete {false}; //!< drop Clusters with less than 'binning' members.
+    QcrCell<bool> lazyImages {false};     //!< load images of new files on demand, see ImagePool
+    QcrCell<bool> scratchImages {false};  //!< keep images of new files in a memory-mapped file
+    QcrCell<bool> compressImages {false}; //!< keep count images of new files compressed
+    QcrCell<bool> cacheRawfiles {false};  //!< keep binary copies of new files, see rawfile_cache.h
+    QcrCell<bool> compressRawfileCache {false}; //!< deflate the images in those copies
 
     //! Owning all `Cluster`s. Recomputed in updateClusters.
     //! Use of unique_ptr is unavoidable because of deleted default constructors (confirmed dec18).
@@ -111,6 +116,8 @@ public:
 private:
     //! Owning the loaded `Datafile`s.
     std::vector<Datafile> files_;
+    //! Holds the images of files loaded with scratchImages set; shared with those images.
+    std::shared_ptr<PixelStore> scratch_;
 
     bool hasIncomplete_ {false}; //!< current binning does result in at least one incomplete cluster
 
@@ -0,0 +1,90 @@
+//  ***********************************************************************************************
+//
+//  Steca: stress and texture calculator
+//
+//! @file      core/data/detector_mask.cpp
+//! @brief     Implements class DetectorMask
+//!
+//! @homepage  https://github.com/scgmlz/Steca
+//! @license   GNU General Public License v3 or higher (see COPYING)
+//! @copyright Forschungszentrum Jülich GmbH 2016-2018
+//! @authors   Scientific Computing Group at MLZ (see CITATION, MAINTAINER)
+//
+//  ***********************************************************************************************
+
+#include "core/data/detector_mask.h"
+#include "core/loaders/loaders.h"
+#include "core/session.h"
+#include "qcr/base/debug.h" // qWarning
+#include <QCryptographicHash>
+#include <algorithm>
+
+DetectorMask::DetectorMask()
+    : effective_{[this]()->Effective{
+            const int n = gSession->imageSize().count();
+            Effective ret;
+            if (fromFile_.size() == n)
+                ret.excluded = fromFile_;
+            else if (!fromFile_.empty())
+                qWarning() << "Detector mask ignored, as its size differs from the images";
+            if (gSession->corrset.isEnabledAndValid()) {
+                const Image& normalizer = gSession->corrset.getNormalizer();
+                ret.excluded.resize(n, 0);
+                for (int i=0; i<n; ++i)
+                    if (qIsNaN(normalizer.inten1d(i)))
+                        ret.excluded[i] = 1;
+            }
+            if (std::find(ret.excluded.begin(), ret.excluded.end(), 1) == ret.excluded.end())
+                ret.excluded.clear();
+            else
+                ret.hash = QCryptographicHash::hash(
+                    QByteArray(ret.excluded.data(), ret.excluded.size()),
+                    QCryptographicHash::Sha1);
+            return ret; }}
+{}
+
+void DetectorMask::clear()
+{
+    removeFile();
+}
+
+void DetectorMask::removeFile()
+{
+    filePath_.clear();
+    fromFile_.clear();
+    invalidate();
+    gSession->onDetector();
+}
+
+//! Loads a mask from an image file of any supported type; pixels > 0 or NaN are excluded.
+void DetectorMask::loadFile(const QString& filePath)
+{
+    if (filePath.isEmpty())
+        qFatal("DetectorMask::loadFile called with empty filePath argument");
+    const Rawfile raw = load::loadRawfile(filePath);
+    gSession->setImageSize(raw.imageSize());
+    const std::vector<float> intens = raw.summedImage().denseIntens();
+    const int n = intens.size();
+    fromFile_.resize(n);
+    for (int i=0; i<n; ++i) {
+        const float inten = intens[i];
+        fromFile_[i] = inten > 0 || qIsNaN(inten);
+    }
+    filePath_ = filePath;
+    invalidate();
+    gSession->onDetector();
+}
+
+QJsonObject DetectorMask::toJson() const
+{
+    QJsonObject ret;
+    if (hasFile())
+        ret.insert("file", filePath_);
+    return ret;
+}
+
+void DetectorMask::fromJson(const JsonObj& obj)
+{
+    if (obj.find("file") != obj.end())
+        loadFile(obj.loadString("file"));
+}
@@ -0,0 +1,57 @@
+//  ***********************************************************************************************
+//
+//  Steca: stress and texture calculator
+//
+//! @file      core/data/detector_mask.h
+//! @brief     Defines class DetectorMask
+//!
+//! @homepage  https://github.com/scgmlz/Steca
+//! @license   GNU General Public License v3 or higher (see COPYING)
+//! @copyright Forschungszentrum Jülich GmbH 2016-2018
+//! @authors   Scientific Computing Group at MLZ (see CITATION, MAINTAINER)
+//
+//  ***********************************************************************************************
+
+#ifndef DETECTOR_MASK_H
+#define DETECTOR_MASK_H
+
+#include "core/typ/json.h"
+#include "core/typ/lazy_data.h"
+#include <QByteArray>
+
+//! Detector pixels that are excluded from projection.
+
+//! A pixel is excluded if it is set in the mask file (intensity > 0 or NaN), or if the
+//! correction is enabled and the normalizer is invalid at that pixel.
+//! Excluded pixels are removed from the sorted gamma list of each AngleMap.
+
+class DetectorMask {
+public:
+    DetectorMask();
+    DetectorMask(const DetectorMask&) = delete;
+
+    void fromJson(const JsonObj& obj);
+    void clear();
+    void removeFile();
+    void loadFile(const QString& filePath);
+    void invalidate() const { effective_.invalidate(); } //!< to be called if normalizer changes
+
+    QJsonObject toJson() const;
+    bool hasFile() const { return !filePath_.isEmpty(); }
+    QString filePath() const { return filePath_; }
+    //! One entry per pixel, nonzero if excluded; empty if no pixel is excluded.
+    const std::vector<char>& excluded() const { return effective_.yield().excluded; }
+    //! Hash of excluded(); empty if no pixel is excluded.
+    const QByteArray& hash() const { return effective_.yield().hash; }
+
+private:
+    struct Effective {
+        std::vector<char> excluded;
+        QByteArray hash;
+    };
+    QString filePath_;
+    std::vector<char> fromFile_; //!< one entry per pixel, nonzero if excluded by mask file
+    mutable lazy_data::Cached<Effective> effective_;
+};
+
+#endif // DETECTOR_MASK_H
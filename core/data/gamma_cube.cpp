@@ -0,0 +1,50 @@
+//  ***********************************************************************************************
+//
+//  Steca: stress and texture calculator
+//
+//! @file      core/data/gamma_cube.cpp
+//! @brief     Implements class GammaCube
+//!
+//! @homepage  https://github.com/scgmlz/Steca
+//! @license   GNU General Public License v3 or higher (see COPYING)
+//! @copyright Forschungszentrum Jülich GmbH 2016-2018
+//! @authors   Scientific Computing Group at MLZ (see CITATION, MAINTAINER)
+//
+//  ***********************************************************************************************
+
+#include "core/data/gamma_cube.h"
+#include "qcr/base/debug.h" // ASSERT
+#include <qmath.h>
+
+//! Constructs the cube from histograms of consecutive, disjoint gamma bins covering rgeGma.
+GammaCube::GammaCube(const Range& rgeGma, const std::vector<Histogram>& gmaBins)
+    : rgeGma_{rgeGma}
+{
+    ASSERT(gmaBins.size());
+    const Histogram& first = gmaBins.front();
+    cumulated_.reserve(gmaBins.size() + 1);
+    cumulated_.emplace_back(first.xMin, first.dx, first.size());
+    for (const Histogram& one : gmaBins) {
+        cumulated_.push_back(cumulated_.back());
+        cumulated_.back().add(one);
+    }
+}
+
+//! Returns the raw intensities in the given gamma range.
+Histogram GammaCube::histogram(const Range& rgeGma) const
+{
+    const Histogram& lo = cumulated_.at(edgeIndex(rgeGma.min));
+    Histogram ret = cumulated_.at(edgeIndex(rgeGma.max));
+    for (int i=0; i<ret.size(); ++i) {
+        ret.intens[i] -= lo.intens[i];
+        ret.counts[i] -= lo.counts[i];
+    }
+    return ret;
+}
+
+//! Returns the index of the gamma bin edge nearest to gma.
+int GammaCube::edgeIndex(double gma) const
+{
+    const int ret = qRound((gma - rgeGma_.min) / rgeGma_.width() * numGmaBins());
+    return qMax(0, qMin(ret, numGmaBins()));
+}
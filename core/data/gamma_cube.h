@@ -0,0 +1,44 @@
+//  ***********************************************************************************************
+//
+//  Steca: stress and texture calculator
+//
+//! @file      core/data/gamma_cube.h
+//! @brief     Defines class GammaCube
+//!
+//! @homepage  https://github.com/scgmlz/Steca
+//! @license   GNU General Public License v3 or higher (see COPYING)
+//! @copyright Forschungszentrum Jülich GmbH 2016-2018
+//! @authors   Scientific Computing Group at MLZ (see CITATION, MAINTAINER)
+//
+//  ***********************************************************************************************
+
+#ifndef GAMMA_CUBE_H
+#define GAMMA_CUBE_H
+
+#include "core/typ/histogram.h"
+#include "core/typ/range.h"
+#include <vector>
+
+//! Raw intensities of a cluster, binned in gamma and 2theta, summed cumulatively along gamma.
+
+//! The intensities in any gamma range are obtained as the difference of two rows,
+//! without going back to the images. Range limits are rounded to the nearest gamma bin edge.
+
+class GammaCube {
+public:
+    GammaCube() = delete;
+    GammaCube(const Range& rgeGma, const std::vector<Histogram>& gmaBins);
+    GammaCube(const GammaCube&) = delete;
+    GammaCube(GammaCube&&) = default;
+
+    int numGmaBins() const { return cumulated_.size() - 1; }
+    Histogram histogram(const Range& rgeGma) const;
+
+private:
+    int edgeIndex(double gma) const;
+
+    const Range rgeGma_;
+    std::vector<Histogram> cumulated_; //!< row g holds the sum of gamma bins [0,g)
+};
+
+#endif // GAMMA_CUBE_H
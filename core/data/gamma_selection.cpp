@@ -19,7 +19,10 @@
 GammaSelection::GammaSelection()
 {
     numSlices.setHook([](int){
-        gSession->onDetector();
+        gSession->onGammaSelection();
+    });
+    numFineBins.setHook([](int){
+        gSession->onGammaSelection();
     });
 }
 
@@ -28,6 +31,7 @@ QJsonObject GammaSelection::toJson() const
     return {
         { "number of slices", QJsonValue(numSlices.val()) },
         { "current slice index", QJsonValue(currSlice.val()) },
+        { "number of fine gamma bins", QJsonValue(numFineBins.val()) },
     };
 }
 
@@ -49,6 +53,7 @@ void GammaSelection::fromJson(const JsonObj& obj)
 {
     numSlices.setVal(obj.loadInt("number of slices"));
     currSlice.setVal(obj.loadInt("current slice index"));
+    numFineBins.setVal(obj.loadUint("number of fine gamma bins", 0));
 }
 
 //! Resets fullRange_ according to loaded data.
@@ -33,6 +33,7 @@ public:
 
     QcrCell<int> numSlices {1};
     QcrCell<int> currSlice {1}; // counting from 1, for user convenience
+    QcrCell<int> numFineBins {0}; //!< gamma resolution of cluster's GammaCube; 0: no cube
     Range limitedGammaRange{};
     bool limit{false};
 };
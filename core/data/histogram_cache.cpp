@@ -0,0 +1,76 @@
+//  ***********************************************************************************************
+//
+//  Steca: stress and texture calculator
+//
+//! @file      core/data/histogram_cache.cpp
+//! @brief     Implements class HistogramCache
+//!
+//! @homepage  https://github.com/scgmlz/Steca
+//! @license   GNU General Public License v3 or higher (see COPYING)
+//! @copyright Forschungszentrum Jülich GmbH 2016-2018
+//! @authors   Scientific Computing Group at MLZ (see CITATION, MAINTAINER)
+//
+//  ***********************************************************************************************
+
+#include "core/data/histogram_cache.h"
+
+bool HistogramCache::Key::operator==(const Key& that) const
+{
+    return rgeGma.min == that.rgeGma.min && rgeGma.max == that.rgeGma.max
+        && numSlices == that.numSlices && exclusive == that.exclusive
+        && minTth == that.minTth && deltaTth == that.deltaTth && numBins == that.numBins
+        && normalizer == that.normalizer;
+}
+
+HistogramCache::HistogramCache(size_t budget)
+    : budget_{budget}
+{
+    enabled.setHook([this](bool on){
+        if (!on)
+            clear(); });
+}
+
+//! Returns the cached projection of measurement m, or nullptr.
+
+//! The result is valid until the next call of insert or clear.
+
+const std::vector<Histogram>* HistogramCache::find(const Measurement* m, const Key& key) const
+{
+    const auto range = index_.equal_range(m);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second->key == key) {
+            entries_.splice(entries_.end(), entries_, it->second); // make most recently used
+            return &it->second->hists;
+        }
+    }
+    return nullptr;
+}
+
+void HistogramCache::insert(const Measurement* m, const Key& key, std::vector<Histogram>&& hists)
+{
+    size_t size = sizeof(Entry);
+    for (const Histogram& hist : hists)
+        size += hist.intens.capacity() * sizeof(double) + hist.counts.capacity() * sizeof(int);
+    entries_.push_back({m, key, std::move(hists), size});
+    index_.emplace(m, std::prev(entries_.end()));
+    memSize_ += size;
+    while (memSize_ > budget_ && entries_.size() > 1) {
+        const Entry& oldest = entries_.front();
+        const auto range = index_.equal_range(oldest.measurement);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == entries_.begin()) {
+                index_.erase(it);
+                break;
+            }
+        }
+        memSize_ -= oldest.memSize;
+        entries_.pop_front();
+    }
+}
+
+void HistogramCache::clear() const
+{
+    entries_.clear();
+    index_.clear();
+    memSize_ = 0;
+}
@@ -0,0 +1,76 @@
+//  ***********************************************************************************************
+//
+//  Steca: stress and texture calculator
+//
+//! @file      core/data/histogram_cache.h
+//! @brief     Defines class HistogramCache
+//!
+//! @homepage  https://github.com/scgmlz/Steca
+//! @license   GNU General Public License v3 or higher (see COPYING)
+//! @copyright Forschungszentrum Jülich GmbH 2016-2018
+//! @authors   Scientific Computing Group at MLZ (see CITATION, MAINTAINER)
+//
+//  ***********************************************************************************************
+
+#ifndef HISTOGRAM_CACHE_H
+#define HISTOGRAM_CACHE_H
+
+#include "core/base/angles.h"
+#include "core/typ/histogram.h"
+#include "core/typ/range.h"
+#include "qcr/engine/cell.h"
+#include <list>
+#include <unordered_map>
+
+class Measurement;
+
+//! Projections of single `Measurement`s, to be summed up into the projections of clusters.
+
+//! With this cache enabled, a change of binning or of the cluster selection only requires to
+//! add up histograms, provided the new clusters have the same 2theta grid as the old ones.
+//! Entries are made by algo::projectSlices. Least recently used ones are dropped when
+//! the memory budget is exceeded. Not thread safe.
+
+class HistogramCache {
+public:
+    //! Everything besides the Measurement the projection depends on, except for the detector.
+    struct Key {
+        Range rgeGma;
+        int numSlices;
+        bool exclusive;
+        deg minTth;
+        deg deltaTth;
+        int numBins;
+        int normalizer; //!< generation of the normalizer, or -1 if none is applied
+        bool operator==(const Key&) const;
+    };
+
+    HistogramCache() = delete;
+    HistogramCache(size_t budget);
+    HistogramCache(const HistogramCache&) = delete;
+
+    const std::vector<Histogram>* find(const Measurement*, const Key&) const;
+    void insert(const Measurement*, const Key&, std::vector<Histogram>&&);
+    void clear() const; //!< to be called if the detector geometry, the image cut, or the mask change
+
+    size_t memSize() const { return memSize_; }
+    int size() const { return entries_.size(); }
+
+    QcrCell<bool> enabled {false};
+
+private:
+    struct Entry {
+        const Measurement* measurement;
+        Key key;
+        std::vector<Histogram> hists;
+        size_t memSize;
+    };
+    using Entries = std::list<Entry>;
+
+    const size_t budget_;
+    mutable size_t memSize_ {0};
+    mutable Entries entries_; //!< MRU last
+    mutable std::unordered_multimap<const Measurement*, Entries::iterator> index_;
+};
+
+#endif // HISTOGRAM_CACHE_H
@@ -18,11 +18,16 @@
 //  ***********************************************************************************************
 //! @class ImageLens
 
-ImageLens::ImageLens(const Image& image, bool trans, bool cut)
+ImageLens::ImageLens(const Image& image, bool trans, bool cut, bool corrected)
     : trans_{trans}
     , cut_ {cut} // if true then remove borders for good; this would rescale the rendered image
+    , corrected_ {corrected}
     , image_ {image}
-{}
+{
+    // per-pixel access to a sparse image would take a binary search for each pixel
+    if (image.isSparse())
+        dense_ = image.denseIntens();
+}
 
 size2d ImageLens::imgSize() const
 {
@@ -78,7 +83,9 @@ float ImageLens::imageInten(int i, int j) const
         doTrans(i, j);
     if (cut_)
         doCut(i, j);
-    float ret = image_.inten2d(i, j);
+    float ret = dense_.empty() ? image_.inten2d(i, j) : dense_[j * image_.size().w + i];
+    if (corrected_)
+        return ret;
     const Image& normalizer = gSession->corrset.getNormalizer();
     if (gSession->corrset.isEnabledAndValid())
         ret *= normalizer.inten2d(i, j);
@@ -90,6 +97,11 @@ const Range& ImageLens::rgeInten(bool fixed) const
     if (fixed)
         return gSession->activeClusters.rgeFixedInten.yield();
            // TODO restore from pre d9714895: (trans_, cut_);
+    if (!rgeInten_.isValid() && image_.isSparse() && !cut_
+        && (corrected_ || !gSession->corrset.isEnabledAndValid())) {
+        // the lens shows all pixels unchanged, possibly transposed
+        rgeInten_ = image_.rgeInten();
+    }
     if (!rgeInten_.isValid()) {
         size2d sz = imgSize();
         for (int j=0; j<sz.h; ++j)
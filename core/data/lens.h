@@ -17,6 +17,7 @@
 
 #include "core/typ/curve.h"
 #include "core/typ/size2d.h"
+#include <vector>
 
 class Image;
 
@@ -24,7 +25,7 @@ class Image;
 
 class ImageLens {
 public:
-    ImageLens(const Image&, bool trans, bool cut);
+    ImageLens(const Image&, bool trans, bool cut, bool corrected=false);
 
     size2d imgSize() const;
     float imageInten(int i, int j) const;
@@ -35,7 +36,9 @@ private:
     void doCut(int& i, int& j) const;
     size2d transCutSize(size2d) const;
     bool trans_, cut_;
+    bool corrected_; //!< image_ is already multiplied by the normalizer
     const Image& image_;
+    std::vector<float> dense_; //!< all pixels, if image_ is sparse; densified once per lens
     mutable Range rgeInten_;
 };
 
@@ -0,0 +1,114 @@
+//  ***********************************************************************************************
+//
+//  Steca: stress and texture calculator
+//
+//! @file      core/data/projection_table.cpp
+//! @brief     Implements class ProjectionTable
+//!
+//! @homepage  https://github.com/scgmlz/Steca
+//! @license   GNU General Public License v3 or higher (see COPYING)
+//! @copyright Forschungszentrum Jülich GmbH 2016-2018
+//! @authors   Scientific Computing Group at MLZ (see CITATION, MAINTAINER)
+//
+//  ***********************************************************************************************
+
+#include "core/data/projection_table.h"
+#include "core/data/angle_map.h"
+#include "qcr/base/debug.h" // ASSERT
+#include <qmath.h>
+#include <algorithm>
+
+ProjectionTable::ProjectionTable(
+    const AngleMap& angleMap, const Range& rgeGma, int numSlices, bool exclusive,
+    deg minTth, deg deltaTth, int numBins)
+    : rgeGma_{rgeGma}
+    , numSlices_{numSlices}
+    , exclusive_{exclusive}
+    , minTth_{minTth}
+    , deltaTth_{deltaTth}
+    , numBins_{numBins}
+{
+    ASSERT(numSlices_ > 0);
+    ASSERT(numBins_ > 0);
+    ASSERT(deltaTth_ > 0);
+
+    // first pass: combined slice-and-bin index of each pixel in each slice, and bin occupation
+    const int numAllBins = numSlices_ * numBins_;
+    std::vector<int> sources; // pixel indices, in order of gamma within each slice
+    std::vector<int> bins;    // corresponding combined indices
+    binStart_.assign(numAllBins + 1, 0);
+    auto addPixel = [&](int ind, int jS) {
+        const deg tth = angleMap.tthAt1(ind);
+        int ti = qFloor((tth - minTth_) / deltaTth_);
+        // it can overshoot due to floating point calculation
+        ti = qMax(0, qMin(ti, numBins_ - 1));
+        sources.push_back(ind);
+        bins.push_back(jS * numBins_ + ti);
+        ++binStart_[bins.back() + 1];
+    };
+    const std::vector<int>* gmaIndexes = nullptr;
+    int gmaIndexMin = 0, gmaIndexMax = 0;
+    if (exclusive_) {
+        angleMap.getGmaIndexes(rgeGma, gmaIndexes, gmaIndexMin, gmaIndexMax);
+        ASSERT(gmaIndexes);
+        ASSERT(gmaIndexMin <= gmaIndexMax);
+        ASSERT(gmaIndexMax <= gmaIndexes->size());
+        const double deltaGma = rgeGma.width() / numSlices_;
+        for (int k=gmaIndexMin; k<gmaIndexMax; ++k) {
+            const int ind = (*gmaIndexes)[k];
+            int jS = qFloor((angleMap.gmaAt1(ind) - rgeGma.min) / deltaGma);
+            jS = qMax(0, qMin(jS, numSlices_ - 1));
+            addPixel(ind, jS);
+        }
+    } else {
+        for (int jS=0; jS<numSlices_; ++jS) {
+            const Range rgeSlice = numSlices_==1 ? rgeGma : rgeGma.slice(jS, numSlices_);
+            angleMap.getGmaIndexes(rgeSlice, gmaIndexes, gmaIndexMin, gmaIndexMax);
+            ASSERT(gmaIndexes);
+            ASSERT(gmaIndexMin <= gmaIndexMax);
+            ASSERT(gmaIndexMax <= gmaIndexes->size());
+            for (int k=gmaIndexMin; k<gmaIndexMax; ++k)
+                addPixel((*gmaIndexes)[k], jS);
+        }
+    }
+    for (int i=0; i<numAllBins; ++i)
+        binStart_[i + 1] += binStart_[i];
+
+    // second pass: counting sort of pixel indices by combined index
+    pixels_.resize(sources.size());
+    std::vector<int> pos(binStart_.begin(), binStart_.end() - 1);
+    for (int k=0; k<sources.size(); ++k)
+        pixels_[pos[bins[k]]++] = sources[k];
+}
+
+bool ProjectionTable::matches(
+    const Range& rgeGma, int numSlices, bool exclusive,
+    deg minTth, deg deltaTth, int numBins) const
+{
+    return rgeGma.min == rgeGma_.min && rgeGma.max == rgeGma_.max && numSlices == numSlices_
+        && exclusive == exclusive_ && minTth == minTth_ && deltaTth == deltaTth_ && numBins == numBins_;
+}
+
+size_t ProjectionTable::memSize() const
+{
+    return sizeof(*this) + binStart_.capacity() * sizeof(int) + pixels_.capacity() * sizeof(int)
+        + pixelStart_.capacity() * sizeof(int) + pixelBins_.capacity() * sizeof(int);
+}
+
+void ProjectionTable::prepareSparse() const
+{
+    std::call_once(sparseOnce_, [this]() {
+            const int numPixels =
+                pixels_.empty() ? 0 : *std::max_element(pixels_.begin(), pixels_.end()) + 1;
+            pixelStart_.assign(numPixels + 1, 0);
+            for (int ind : pixels_)
+                ++pixelStart_[ind + 1];
+            for (int ind=0; ind<numPixels; ++ind)
+                pixelStart_[ind + 1] += pixelStart_[ind];
+            pixelBins_.resize(pixels_.size());
+            std::vector<int> pos(pixelStart_.begin(), pixelStart_.end() - 1);
+            for (int i=0; i+1<binStart_.size(); ++i)
+                for (int k=binStart_[i]; k<binStart_[i+1]; ++k)
+                    pixelBins_[pos[pixels_[k]]++] = i;
+        });
+}
@@ -0,0 +1,75 @@
+//  ***********************************************************************************************
+//
+//  Steca: stress and texture calculator
+//
+//! @file      core/data/projection_table.h
+//! @brief     Defines class ProjectionTable
+//!
+//! @homepage  https://github.com/scgmlz/Steca
+//! @license   GNU General Public License v3 or higher (see COPYING)
+//! @copyright Forschungszentrum Jülich GmbH 2016-2018
+//! @authors   Scientific Computing Group at MLZ (see CITATION, MAINTAINER)
+//
+//  ***********************************************************************************************
+
+#ifndef PROJECTION_TABLE_H
+#define PROJECTION_TABLE_H
+
+#include "core/base/angles.h"
+#include "core/typ/range.h"
+#include <mutex>
+#include <vector>
+
+class AngleMap;
+
+//! Pixel indices of one AngleMap, grouped by gamma slice and 2theta bin.
+
+//! The gamma range is divided into numSlices equal slices, as in Range::slice;
+//! each slice is binned into the same numBins 2theta bins.
+//!
+//! Storage is compressed-sparse-row like: the pixels of bin ti in slice jS are
+//! pixels()[binStart()[i]] .. pixels()[binStart()[i+1]-1], where i = jS*numBins + ti.
+//! Once this table is computed, projecting an image requires no floating-point
+//! computations besides the summation of intensities.
+//! Pixels on the boundary between two slices are listed in both, as they would be
+//! when each slice were projected separately; unless the table is constructed with
+//! `exclusive` set, in which case every pixel belongs to exactly one slice.
+
+class ProjectionTable {
+public:
+    ProjectionTable() = delete;
+    ProjectionTable(const AngleMap&, const Range& rgeGma, int numSlices, bool exclusive,
+                    deg minTth, deg deltaTth, int numBins);
+    ProjectionTable(const ProjectionTable&) = delete;
+
+    bool matches(const Range& rgeGma, int numSlices, bool exclusive,
+                 deg minTth, deg deltaTth, int numBins) const;
+
+    int numSlices() const { return numSlices_; }
+    int numBins() const { return numBins_; } //!< per slice
+    const std::vector<int>& binStart() const { return binStart_; }
+    const std::vector<int>& pixels() const { return pixels_; }
+    size_t memSize() const;
+
+    //! Inverse table, for projecting sparse images: the bins of pixel ind are
+    //! pixelBins()[pixelStart()[ind]] .. pixelBins()[pixelStart()[ind+1]-1].
+    //! Computed by the first call of prepareSparse(), which must be made before; thread safe.
+    void prepareSparse() const;
+    const std::vector<int>& pixelStart() const { return pixelStart_; }
+    const std::vector<int>& pixelBins() const { return pixelBins_; }
+
+private:
+    const Range rgeGma_;
+    const int numSlices_;
+    const bool exclusive_;
+    const deg minTth_;
+    const deg deltaTth_;
+    const int numBins_;
+    std::vector<int> binStart_; //!< size numSlices_*numBins_+1
+    std::vector<int> pixels_;   //!< pixel indices, sorted by bin
+    mutable std::vector<int> pixelStart_; //!< size (max pixel index)+2, or empty
+    mutable std::vector<int> pixelBins_;
+    mutable std::once_flag sparseOnce_;
+};
+
+#endif // PROJECTION_TABLE_H
@@ -14,7 +14,8 @@
 
 #include "core/loaders/fastyamlloader.h"
 #include "core/base/exception.h"
-#include <sstream>
+#include "core/base/parallel.h"
+#include <cstring>
 
 // Allows for a very verbose yaml parser for debugging purposes:
 // #define VERBOSE_YAML_PARSER
@@ -83,144 +84,185 @@ yaml_event_type_t parser_parse(yaml_parser_t* parser, yaml_event_t& event)
     qFatal("unreachable");
 }
 
+bool isSeparator(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == ',';
+}
+
+//! Parses an unsigned decimal at p, advancing p. Returns false if there is none.
+bool parseSize(const char*& p, const char* end, size_t& ret)
+{
+    while (p < end && isSeparator(*p))
+        ++p;
+    if (p == end || *p < '0' || *p > '9')
+        return false;
+    ret = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p)
+        ret = 10 * ret + (*p - '0');
+    return true;
+}
+
+//! Returns the number of separated tokens in [p,end).
+size_t countTokens(const char* p, const char* end)
+{
+    size_t ret = 0;
+    bool inToken = false;
+    for (; p < end; ++p) {
+        const bool sep = isSeparator(*p);
+        ret += inToken && sep;
+        inToken = !sep;
+    }
+    return ret + inToken;
+}
+
+//! Parses the separated integers in [p,end) into out, which must have room for all of them.
+void parseInts(const char* p, const char* end, float* out)
+{
+    while (true) {
+        while (p < end && isSeparator(*p))
+            ++p;
+        if (p == end)
+            return;
+        const bool negative = *p == '-';
+        if (*p == '-' || *p == '+')
+            ++p;
+        const char* const digits = p;
+        long long v = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p)
+            v = 10 * v + (*p - '0');
+        if (p == digits || (p < end && !isSeparator(*p)))
+            THROW("invalid integer in !array2d");
+        *out++ = negative ? -v : v;
+    }
+}
+
+//! Returns the start of the token containing or following p, or end.
+const char* alignToToken(const char* p, const char* begin, const char* end)
+{
+    if (p > begin && !isSeparator(p[-1]))
+        while (p < end && !isSeparator(*p))
+            ++p;
+    return p;
+}
+
 } // namespace
 
 //  ***********************************************************************************************
 
 namespace loadYAML {
 
-size_t YamlNode::size() const
+//! Parses the value of an !array2d scalar, "width height [v v ...]", into array.
+
+//! Large arrays are split into chunks at token boundaries, which are counted and then
+//! parsed in parallel, writing straight into array.data.
+
+void parseArray2d(const char* text, size_t length, YamlArray2d& array)
 {
-    if (nodeType_ != eNodeType::SEQUENCE)
-        qFatal("invalid call of YamlNode::size()");
-    return sequence_->size();
+    const char* p = text;
+    const char* end = text + length;
+    if (!parseSize(p, end, array.width) || !parseSize(p, end, array.height))
+        THROW("invalid !array2d: missing width and height");
+    p = static_cast<const char*>(memchr(p, '[', end - p));
+    if (!p)
+        THROW("invalid !array2d: missing '['");
+    ++p;
+    while (end > p && end[-1] != ']')
+        --end;
+    if (end == p)
+        THROW("invalid !array2d: missing ']'");
+    --end;
+
+    const size_t n = array.width * array.height;
+    array.data.resize(n);
+    const size_t minChunkSize = 1 << 20; // characters; smaller arrays are parsed serially
+    const int numChunks = qMin(parallel::numThreads(), int((end - p) / minChunkSize) + 1);
+    std::vector<const char*> chunkStart(numChunks + 1);
+    for (int i=0; i<numChunks; ++i)
+        chunkStart[i] = alignToToken(p + (end - p) * i / numChunks, p, end);
+    chunkStart[numChunks] = end;
+
+    std::vector<size_t> outStart(numChunks + 1, 0);
+    parallel::forChunks(numChunks, [&](int, int begin, int stop) {
+        for (int i=begin; i<stop; ++i)
+            outStart[i + 1] = countTokens(chunkStart[i], chunkStart[i + 1]);
+    });
+    for (int i=0; i<numChunks; ++i)
+        outStart[i + 1] += outStart[i];
+    if (outStart[numChunks] != n)
+        THROW(QString("invalid !array2d: expected %1 values, found %2")
+              .arg(n).arg(outStart[numChunks]));
+
+    parallel::forChunks(numChunks, [&](int, int begin, int stop) {
+        for (int i=begin; i<stop; ++i)
+            parseInts(chunkStart[i], chunkStart[i + 1], array.data.data() + outStart[i]);
+    });
 }
 
-YamlNode::SequenceType::const_iterator YamlNode::begin() const
+YamlEvents::YamlEvents(const std::string& filePath)
+    : file_{fopen(filePath.c_str(), "r")}
 {
-    if (nodeType_ != eNodeType::SEQUENCE)
-        THROW("unexpected node where we expected sequence cbegin");
-    return sequence_->cbegin();
+    if (!file_)
+        THROW("Failed to open file!");
+    if (!yaml_parser_initialize(&parser_))
+        qFatal("Failed to initialize YAML parser");
+    yaml_parser_set_input_file(&parser_, file_);
 }
 
-YamlNode::SequenceType::const_iterator YamlNode::end() const
+YamlEvents::~YamlEvents()
 {
-    if (nodeType_ != eNodeType::SEQUENCE)
-        THROW("unexpected node where we expected sequence cend");
-    return sequence_->cend();
+    if (hasEvent_)
+        yaml_event_delete(&event_);
+    yaml_parser_delete(&parser_);
+    fclose(file_);
 }
 
-YamlNode parseYamlFast(yaml_parser_t* parser, const yaml_event_t& prevEvent)
+const yaml_event_t& YamlEvents::next()
 {
-    switch(prevEvent.type) {
-    case YAML_NO_EVENT:
-        THROW("unexpected YAML_NO_EVENT");
-    case YAML_STREAM_START_EVENT: {
-        YAML_DEBUG_OUT("DEBUG[parseYamlFast2] YAML_STREAM_START_EVENT");
-        yaml_event_t event;
-        parser_parse(parser, event);
-        return parseYamlFast(parser, event);
-    }
-    case YAML_STREAM_END_EVENT:
-        THROW("unexpected YAML_STREAM_END_EVENT");
-    case YAML_DOCUMENT_START_EVENT: {
-        YAML_DEBUG_OUT("DEBUG[parseYamlFast2] YAML_DOCUMENT_START_EVENT");
-        yaml_event_t event;
-        parser_parse(parser, event);
-        return parseYamlFast(parser, event);
-    }
-    case YAML_DOCUMENT_END_EVENT:
-        THROW("unexpected YAML_DOCUMENT_END_EVENT");
-        break;
-    case YAML_SEQUENCE_START_EVENT: {
-        YAML_DEBUG_OUT("DEBUG[parseYamlFast2] YAML_SEQUENCE_START_EVENT");
-        auto* sequence = new YamlNode::SequenceType;
-        yaml_event_t event;
-        while(YAML_SEQUENCE_END_EVENT != parser_parse(parser, event)) {
-            sequence->push_back(parseYamlFast(parser, event));
-            yaml_event_delete(&event);
-        };
-        YAML_DEBUG_OUT("DEBUG[parseYamlFast2] YAML_SEQUENCE_END_EVENT");
-        yaml_event_delete(&event);
-        return YamlNode{sequence};
-    }
-    case YAML_SEQUENCE_END_EVENT:
-        THROW("unexpected YAML_SEQUENCE_END_EVENT");
-    case YAML_MAPPING_START_EVENT: {
-        YAML_DEBUG_OUT("DEBUG[parseYamlFast2] YAML_MAPPING_START_EVENT");
-        auto* map = new YamlNode::MapType;
-        yaml_event_t event;
-        while(YAML_MAPPING_END_EVENT != parser_parse(parser, event)) {
-            const QString key = QString::fromLatin1(
-                reinterpret_cast<const char*>(event.data.scalar.value));
-            YAML_DEBUG_OUT("DEBUG[parseYamlFast2] key == " << key);
-            yaml_event_delete(&event);
-            parser_parse(parser, event);
-            const YamlNode value{parseYamlFast(parser, event)};
-            map->emplace(key, std::move(value));
-            yaml_event_delete(&event);
+    if (hasEvent_)
+        yaml_event_delete(&event_);
+    hasEvent_ = false;
+    parser_parse(&parser_, event_); // throws
+    hasEvent_ = true;
+    YAML_DEBUG_OUT("DEBUG[YamlEvents] event " << event_.type);
+    return event_;
+}
+
+void YamlEvents::skip()
+{
+    int depth = 0;
+    while (true) {
+        switch (type()) {
+        case YAML_SEQUENCE_START_EVENT:
+        case YAML_MAPPING_START_EVENT:
+            ++depth;
+            break;
+        case YAML_SEQUENCE_END_EVENT:
+        case YAML_MAPPING_END_EVENT:
+            --depth;
+            break;
+        case YAML_STREAM_END_EVENT:
+            THROW("unexpected YAML_STREAM_END_EVENT");
+        default:
+            break;
         }
-        yaml_event_delete(&event);
-        return YamlNode{map};
+        if (depth == 0)
+            return;
+        next();
     }
-    case YAML_MAPPING_END_EVENT:
-        THROW("unexpected YAML_MAPPING_END_EVENT");
-    case YAML_ALIAS_EVENT:
-        THROW("unexpected YAML_ALIAS_EVENT");
-    case YAML_SCALAR_EVENT:
-        YAML_DEBUG_OUT("DEBUG[parseYamlFast2] YAML_SCALAR_EVENT = "
-                       << QString::fromLatin1(
-                           reinterpret_cast<char*>(prevEvent.data.scalar.value)));
-        if (reinterpret_cast<char*>(prevEvent.data.scalar.tag) // handle !array2d tag:
-            && std::string(reinterpret_cast<char*>(prevEvent.data.scalar.tag)) == "!array2d") {
-            YAML_DEBUG_OUT("DEBUG[parseYamlFast2] YAML_SCALAR_EVENT, tag = !array2d");
-
-            std::stringstream arrayStr(
-                reinterpret_cast<char*>(prevEvent.data.scalar.value), std::ios_base::in);
-
-            std::shared_ptr<YamlArray2d> array2d(new YamlArray2d);
-
-            arrayStr >> array2d->width;
-            arrayStr >> array2d->height;
-            // find start of actual array data:
-            while ('[' != arrayStr.get())
-                ;
-            array2d->data.reserve(array2d->width * array2d->height);
-            for (size_t i = 0; i < array2d->width * array2d->height; i++) {
-                int v;
-                arrayStr >> v;
-                array2d->data.push_back(v);
-            }
-            return YamlNode{array2d};
-        } else
-            YAML_DEBUG_OUT("DEBUG[parseYamlFast2] YAML_SCALAR_EVENT = "
-                           << QString::fromLatin1(
-                               reinterpret_cast<char*>(prevEvent.data.scalar.value)));
-        return YamlNode{QString::fromLatin1(reinterpret_cast<char*>(prevEvent.data.scalar.value))};
-    default:
-        break;
-    }
-    qFatal("unreachable");
 }
 
-const YamlNode loadYamlFast(const std::string& filePath) {
-
-    FILE* file{fopen(filePath.c_str(), "r")};
-    if(!file)
-        THROW("Failed to open file!");
-
-    auto* parser = new yaml_parser_t;
-    if(!yaml_parser_initialize(parser))
-        qFatal("Failed to initialize YAML parser");
-
-    yaml_parser_set_input_file(parser, file);
+std::string YamlEvents::scalar() const
+{
+    if (type() != YAML_SCALAR_EVENT)
+        THROW("unexpected node where we expected scalar");
+    return std::string(
+        reinterpret_cast<const char*>(event_.data.scalar.value), event_.data.scalar.length);
+}
 
-    yaml_event_t event;
-    parser_parse(parser, event);
-    auto result = parseYamlFast(parser, event);
-    yaml_event_delete(&event);
-    yaml_parser_delete(parser);
-    return result;
+bool YamlEvents::hasTag(const char* tag) const
+{
+    return type() == YAML_SCALAR_EVENT && event_.data.scalar.tag
+        && !strcmp(reinterpret_cast<const char*>(event_.data.scalar.tag), tag);
 }
 
 } // namespace loadYAML
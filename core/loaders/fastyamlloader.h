@@ -16,9 +16,8 @@
 #define FASTYAMLLOADER_H
 
 #include <yaml.h>
-#include <map>
-#include <memory>
-#include <QDebug>
+#include <string>
+#include <vector>
 
 namespace loadYAML {
 
@@ -29,81 +28,31 @@ struct YamlArray2d {
     std::vector<float> data;
 };
 
-//! Data tree, to be initialized from YAML file.
+//! Pull reader for the event stream of a YAML file.
 
-class YamlNode {
-public:
-    typedef QString KeyType;
-    typedef std::map<KeyType, YamlNode> MapType;
-    typedef std::vector<YamlNode> SequenceType;
-    typedef QString ScalarType;
-
-    enum class eNodeType {
-        MAP,
-        SEQUENCE,
-        SCALAR,
-    };
-
-    YamlNode() = delete;
-
-    YamlNode(MapType* map) : nodeType_{eNodeType::MAP}, map_{map} {}
-
-    YamlNode(SequenceType* sequence) : nodeType_{eNodeType::SEQUENCE}, sequence_{sequence} {}
-
-    YamlNode(ScalarType&& scalar) : nodeType_{eNodeType::SCALAR}, scalar_{scalar} {}
-
-    YamlNode(std::shared_ptr<YamlArray2d> array2d)
-        : nodeType_{eNodeType::SCALAR} , array2d_{array2d} {}
-
-    YamlNode(const YamlNode&) = default; // needed by map_->emplace
-    YamlNode& operator= (const YamlNode&) = delete;
+//! Allows a loader to pick out the values it needs without building a tree of the whole file.
 
-    inline bool isSequence() const { return nodeType_ == eNodeType::SEQUENCE; }
-    inline bool isMap() const      { return nodeType_ == eNodeType::MAP; }
-    inline bool isScalar() const   { return nodeType_ == eNodeType::SCALAR; }
-
-    inline const ScalarType& value() const { return scalar_; }
-
-    inline double doubleValue(double defaultVal = Q_QNAN) const
-    {
-        bool ok = false;
-        auto result = scalar_.toDouble(&ok);
-        return ok ? result : defaultVal;
-    }
-
-    inline int intValue(int defaultVal = 0, int base = 10) const
-    {
-        bool ok = false;
-        auto result = scalar_.toInt(&ok, base);
-        return ok ? result : defaultVal;
-    }
-
-    inline std::shared_ptr<YamlArray2d> array2dValue() const { return array2d_; }
-
-    inline const YamlNode& operator[](const KeyType& key) const
-    {
-        return map_->at(key);
-    }
-
-    inline const YamlNode& operator[](const size_t& index) const
-    {
-        return sequence_->at(index);
-    }
-
-    size_t size() const; //!< Returns sequence size
+class YamlEvents {
+public:
+    YamlEvents(const std::string& filePath);
+    YamlEvents(const YamlEvents&) = delete;
+    ~YamlEvents();
 
-    SequenceType::const_iterator begin() const;
-    SequenceType::const_iterator end() const;
+    const yaml_event_t& next(); //!< Advances to the next event, and returns it.
+    const yaml_event_t& current() const { return event_; }
+    yaml_event_type_t type() const { return event_.type; }
+    void skip(); //!< Skips the node that starts with the current event.
+    std::string scalar() const; //!< Returns value of the current event, which must be a scalar.
+    bool hasTag(const char* tag) const; //!< True if current event is a scalar with given tag.
 
 private:
-    const eNodeType nodeType_;
-    const std::shared_ptr<MapType> map_;
-    const std::shared_ptr<SequenceType> sequence_;
-    const ScalarType scalar_;
-    const std::shared_ptr<YamlArray2d> array2d_;
+    FILE* file_;
+    yaml_parser_t parser_;
+    yaml_event_t event_;
+    bool hasEvent_ {false};
 };
 
-const YamlNode loadYamlFast(const std::string& filePath);
+void parseArray2d(const char* text, size_t length, YamlArray2d& array);
 
 } // namespace loadYAML
 
@@ -19,21 +19,41 @@
 #include <qmath.h>
 #include <sstream>
 
+namespace {
+
+//! Opens a Caress file with its own reader state, so that several files can be read concurrently.
+
+struct CaressFile {
+    CaressFile(const QString& filePath)
+        : p{allocate_raw_infovars()}
+    {
+        if (!p)
+            THROW("Cannot allocate reader for data file " + filePath);
+        if (open_data_file_r(p, filePath.toLocal8Bit().data())) {
+            free_raw_infovars(p);
+            THROW("Cannot open data file " + filePath);
+        }
+    }
+    ~CaressFile()
+    {
+        close_data_file_r(p);
+        free_raw_infovars(p);
+    }
+    raw_infovars* const p;
+};
+
+} // namespace
+
 namespace load {
 
 //! Reads a Caress file, and returns contents as a Rawfile.
 
 //! Called from function load_low_level(..) in file loaders.cpp.
 
-Rawfile loadCaress(const QString& filePath) {
-    Rawfile ret(filePath);
+Rawfile loadCaress(const QString& filePath, const ImageStorage& storage) {
+    Rawfile ret(filePath, storage);
 
-    if(open_data_file(filePath.toLocal8Bit().data(), nullptr))
-        THROW("Cannot open data file " + filePath);
-
-    struct CloseFile { // TODO remove, replace with QFile etc.
-        ~CloseFile() { close_data_file(); }
-    } _;
+    const CaressFile vars(filePath);
 
     bool newObject = false;
     bool workAfterStep = false;
@@ -46,8 +66,7 @@ Rawfile loadCaress(const QString& filePath) {
           pstAxis = 0, sstAxis = 0, omgmAxis = 0, nmT = 0, nmTeload = 0, nmTepos = 0, nmTeext = 0,
           nmXe = 0, nmYe = 0, nmZe = 0;
 
-    int* intens = NULL;
-    int imageSize = 0;
+    std::vector<float> intens; // detector counts of the current measurement
 
     int mon = 0, tim1 = 0;
 
@@ -60,14 +79,15 @@ Rawfile loadCaress(const QString& filePath) {
 
     bool end = false;
     while (!end) {
-        int e_number, e_type, d_type, d_number;
+        int e_number, e_type, d_type;
+        int64 d_number;
         char element[100];
         element[99] = '\0';
         char node[100];
         node[99] = '\0';
         // Return of next_data_unit 0=OK; 1=Error; 2=End of File
         int returnNextDataUnit =
-            next_data_unit(&e_number, &e_type, element, node, &d_type, &d_number);
+            next_data_unit_r(vars.p, &e_number, &e_type, element, node, &d_type, &d_number);
         element[8] = '\0';
         node[8] = '\0';
 
@@ -139,7 +159,7 @@ Rawfile loadCaress(const QString& filePath) {
             }
 
             // Objekt inizialisieren
-            if (intens != NULL) {
+            if (!intens.empty()) {
                 int d, y;
                 char c_m[5];
                 std::string s_m;
@@ -163,13 +183,10 @@ Rawfile loadCaress(const QString& filePath) {
                 deltaMon = mon - prevMon;
                 prevMon = mon;
 
+                const int imageSize = intens.size();
                 int detRel = qRound(sqrt(imageSize));
                 if (!(imageSize > 0 && imageSize == detRel * detRel)) THROW("bad image size");
 
-                std::vector<float> convertedIntens(imageSize);
-                for (int i=0; i<imageSize; ++i)
-                    convertedIntens[i] = intens[i];
-
                 size2d size(detRel, detRel);
 
                 // this is only for testing of a non-square image
@@ -206,11 +223,8 @@ Rawfile loadCaress(const QString& filePath) {
                 md.set("delta_t", deltaTime);
                 md.set("t", tempTime);
 
-                ret.addDataset(std::move(md), size, std::move(convertedIntens));
-
-                delete[] intens;
-                intens = NULL;
-                imageSize = 0;
+                ret.addDataset(std::move(md), size, std::move(intens));
+                intens.clear();
             }
         }
 
@@ -220,7 +234,7 @@ Rawfile loadCaress(const QString& filePath) {
         }
         if (!strncmp(element, "COM ", 4)) {
             c_comment = new char[d_number + 1];
-            if (get_data_unit(c_comment) != 0)
+            if (get_data_unit_r(vars.p, c_comment) != 0)
                 s_comment = "no comment";
             else {
                 c_comment[d_number] = '\0'; // terminiere Char-Array
@@ -231,7 +245,7 @@ Rawfile loadCaress(const QString& filePath) {
         if (!strncmp(element, "DATE ", 5)) {
             char* c_date = NULL;
             c_date = new char[d_number + 1];
-            if (get_data_unit(c_date) != 0)
+            if (get_data_unit_r(vars.p, c_date) != 0)
                 s_date = "unknown";
             else {
                 c_date[d_number] = '\0'; // terminiere Char-Array
@@ -242,310 +256,298 @@ Rawfile loadCaress(const QString& filePath) {
         if (!strncmp(element, "READ  ", 6)) {
             //      TR('R' << node)
             if (!strncmp(node, "TTHS  ", 6)) {
-                if (get_data_unit(&tths) != 0)
+                if (get_data_unit_r(vars.p, &tths) != 0)
                     tths = 0;
                 isTable = true;
             }
             if (!strncmp(node, "TTHR  ", 6)) {
-                if (get_data_unit(&tthr) != 0)
+                if (get_data_unit_r(vars.p, &tthr) != 0)
                     tthr = 0;
                 isRobot = true;
             }
             if (!strncmp(node, "OMGS  ", 6)) {
-                if (get_data_unit(&omgs) != 0)
+                if (get_data_unit_r(vars.p, &omgs) != 0)
                     omgs = 0;
                 isTable = true;
             }
             if (!strncmp(node, "OMGR  ", 6)) {
-                if (get_data_unit(&omgr) != 0)
+                if (get_data_unit_r(vars.p, &omgr) != 0)
                     omgr = 0;
                 isRobot = true;
             }
             if (!strncmp(node, "CHIS  ", 6)) {
-                if (get_data_unit(&chis) != 0)
+                if (get_data_unit_r(vars.p, &chis) != 0)
                     chis = 0;
                 isTable = true;
             }
             if (!strncmp(node, "CHIR  ", 6)) {
-                if (get_data_unit(&chir) != 0)
+                if (get_data_unit_r(vars.p, &chir) != 0)
                     chir = 0;
                 isRobot = true;
             }
             if (!strncmp(node, "PHIS  ", 6)) {
-                if (get_data_unit(&phis) != 0)
+                if (get_data_unit_r(vars.p, &phis) != 0)
                     phis = 0;
                 isTable = true;
             }
             if (!strncmp(node, "PHIR  ", 6)) {
-                if (get_data_unit(&phir) != 0)
+                if (get_data_unit_r(vars.p, &phir) != 0)
                     phir = 0;
                 isRobot = true;
             }
             if (!strncmp(node, "XT    ", 6))
-                if (get_data_unit(&xAxis) != 0)
+                if (get_data_unit_r(vars.p, &xAxis) != 0)
                     xAxis = 0;
             if (!strncmp(node, "XR    ", 6))
-                if (get_data_unit(&xAxis) != 0)
+                if (get_data_unit_r(vars.p, &xAxis) != 0)
                     xAxis = 0;
             if (!strncmp(node, "YT    ", 6))
-                if (get_data_unit(&yAxis) != 0)
+                if (get_data_unit_r(vars.p, &yAxis) != 0)
                     yAxis = 0;
             if (!strncmp(node, "YR    ", 6))
-                if (get_data_unit(&yAxis) != 0)
+                if (get_data_unit_r(vars.p, &yAxis) != 0)
                     yAxis = 0;
             if (!strncmp(node, "ZT    ", 6))
-                if (get_data_unit(&zAxis) != 0)
+                if (get_data_unit_r(vars.p, &zAxis) != 0)
                     zAxis = 0;
             if (!strncmp(node, "ZR    ", 6))
-                if (get_data_unit(&zAxis) != 0)
+                if (get_data_unit_r(vars.p, &zAxis) != 0)
                     zAxis = 0;
             if (!strncmp(node, "PST   ", 6))
-                if (get_data_unit(&pstAxis) != 0)
+                if (get_data_unit_r(vars.p, &pstAxis) != 0)
                     pstAxis = 0;
             if (!strncmp(node, "SST   ", 6))
-                if (get_data_unit(&sstAxis) != 0)
+                if (get_data_unit_r(vars.p, &sstAxis) != 0)
                     sstAxis = 0;
             if (!strncmp(node, "OMGM  ", 6))
-                if (get_data_unit(&omgmAxis) != 0)
+                if (get_data_unit_r(vars.p, &omgmAxis) != 0)
                     omgmAxis = 0;
             if (!strncmp(node, "T     ", 6))
-                if (get_data_unit(&nmT) != 0)
+                if (get_data_unit_r(vars.p, &nmT) != 0)
                     nmT = 0;
             if (!strncmp(node, "TELOAD", 6))
-                if (get_data_unit(&nmTeload) != 0)
+                if (get_data_unit_r(vars.p, &nmTeload) != 0)
                     nmTeload = 0;
             if (!strncmp(node, "TEPOS ", 6))
-                if (get_data_unit(&nmTepos) != 0)
+                if (get_data_unit_r(vars.p, &nmTepos) != 0)
                     nmTepos = 0;
             if (!strncmp(node, "TEEXT ", 6))
-                if (get_data_unit(&nmTeext) != 0)
+                if (get_data_unit_r(vars.p, &nmTeext) != 0)
                     nmTeext = 0;
             if (!strncmp(node, "XE    ", 6))
-                if (get_data_unit(&nmXe) != 0)
+                if (get_data_unit_r(vars.p, &nmXe) != 0)
                     nmXe = 0;
             if (!strncmp(node, "YE    ", 6))
-                if (get_data_unit(&nmYe) != 0)
+                if (get_data_unit_r(vars.p, &nmYe) != 0)
                     nmYe = 0;
             if (!strncmp(node, "ZE    ", 6))
-                if (get_data_unit(&nmZe) != 0)
+                if (get_data_unit_r(vars.p, &nmZe) != 0)
                     nmZe = 0;
         }
         if (!strncmp(element, "SETVALUE", 8)) {
             if (!strncmp(node, "TTHS  ", 6)) {
-                if (get_data_unit(&tths) != 0)
+                if (get_data_unit_r(vars.p, &tths) != 0)
                     tths = 0;
                 isTable = true;
             }
             if (!strncmp(node, "TTHR  ", 6)) {
-                if (get_data_unit(&tthr) != 0)
+                if (get_data_unit_r(vars.p, &tthr) != 0)
                     tthr = 0;
                 isRobot = true;
             }
             if (!strncmp(node, "OMGS  ", 6)) {
-                if (get_data_unit(&omgs) != 0)
+                if (get_data_unit_r(vars.p, &omgs) != 0)
                     omgs = 0;
                 isTable = true;
             }
             if (!strncmp(node, "OMGR  ", 6)) {
-                if (get_data_unit(&omgr) != 0)
+                if (get_data_unit_r(vars.p, &omgr) != 0)
                     omgr = 0;
                 isRobot = true;
             }
             if (!strncmp(node, "CHIS  ", 6)) {
-                if (get_data_unit(&chis) != 0)
+                if (get_data_unit_r(vars.p, &chis) != 0)
                     chis = 0;
                 isTable = true;
             }
             if (!strncmp(node, "CHIR  ", 6)) {
-                if (get_data_unit(&chir) != 0)
+                if (get_data_unit_r(vars.p, &chir) != 0)
                     chir = 0;
                 isRobot = true;
             }
             if (!strncmp(node, "PHIS  ", 6)) {
-                if (get_data_unit(&phis) != 0)
+                if (get_data_unit_r(vars.p, &phis) != 0)
                     phis = 0;
                 isTable = true;
             }
             if (!strncmp(node, "PHIR  ", 6)) {
-                if (get_data_unit(&phir) != 0)
+                if (get_data_unit_r(vars.p, &phir) != 0)
                     phir = 0;
                 isRobot = true;
             }
             if (!strncmp(node, "XT    ", 6))
-                if (get_data_unit(&xAxis) != 0)
+                if (get_data_unit_r(vars.p, &xAxis) != 0)
                     xAxis = 0;
             if (!strncmp(node, "XR    ", 6))
-                if (get_data_unit(&xAxis) != 0)
+                if (get_data_unit_r(vars.p, &xAxis) != 0)
                     xAxis = 0;
             if (!strncmp(node, "YT    ", 6))
-                if (get_data_unit(&yAxis) != 0)
+                if (get_data_unit_r(vars.p, &yAxis) != 0)
                     yAxis = 0;
             if (!strncmp(node, "YR    ", 6))
-                if (get_data_unit(&yAxis) != 0)
+                if (get_data_unit_r(vars.p, &yAxis) != 0)
                     yAxis = 0;
             if (!strncmp(node, "ZT    ", 6))
-                if (get_data_unit(&zAxis) != 0)
+                if (get_data_unit_r(vars.p, &zAxis) != 0)
                     zAxis = 0;
             if (!strncmp(node, "ZR    ", 6))
-                if (get_data_unit(&zAxis) != 0)
+                if (get_data_unit_r(vars.p, &zAxis) != 0)
                     zAxis = 0;
             if (!strncmp(node, "PST   ", 6))
-                if (get_data_unit(&pstAxis) != 0)
+                if (get_data_unit_r(vars.p, &pstAxis) != 0)
                     pstAxis = 0;
             if (!strncmp(node, "SST   ", 6))
-                if (get_data_unit(&sstAxis) != 0)
+                if (get_data_unit_r(vars.p, &sstAxis) != 0)
                     sstAxis = 0;
             if (!strncmp(node, "OMGM  ", 6))
-                if (get_data_unit(&omgmAxis) != 0)
+                if (get_data_unit_r(vars.p, &omgmAxis) != 0)
                     omgmAxis = 0;
             if (!strncmp(node, "T     ", 6))
-                if (get_data_unit(&nmT) != 0)
+                if (get_data_unit_r(vars.p, &nmT) != 0)
                     nmT = 0;
             if (!strncmp(node, "TELOAD", 6))
-                if (get_data_unit(&nmTeload) != 0)
+                if (get_data_unit_r(vars.p, &nmTeload) != 0)
                     nmTeload = 0;
             if (!strncmp(node, "TEPOS ", 6))
-                if (get_data_unit(&nmTepos) != 0)
+                if (get_data_unit_r(vars.p, &nmTepos) != 0)
                     nmTepos = 0;
             if (!strncmp(node, "TEEXT ", 6))
-                if (get_data_unit(&nmTeext) != 0)
+                if (get_data_unit_r(vars.p, &nmTeext) != 0)
                     nmTeext = 0;
             if (!strncmp(node, "XE    ", 6))
-                if (get_data_unit(&nmXe) != 0)
+                if (get_data_unit_r(vars.p, &nmXe) != 0)
                     nmXe = 0;
             if (!strncmp(node, "YE    ", 6))
-                if (get_data_unit(&nmYe) != 0)
+                if (get_data_unit_r(vars.p, &nmYe) != 0)
                     nmYe = 0;
             if (!strncmp(node, "ZE    ", 6))
-                if (get_data_unit(&nmZe) != 0)
+                if (get_data_unit_r(vars.p, &nmZe) != 0)
                     nmZe = 0;
         }
         if (!strncmp(element, "MASTER1V", 8)) {
             //      TR('M' << node)
             if (!strncmp(node, "TTHS  ", 6)) {
-                if (get_data_unit(&tths) != 0)
+                if (get_data_unit_r(vars.p, &tths) != 0)
                     tths = 0;
                 isTable = true;
             }
             if (!strncmp(node, "TTHR  ", 6)) {
-                if (get_data_unit(&tthr) != 0)
+                if (get_data_unit_r(vars.p, &tthr) != 0)
                     tthr = 0;
                 isRobot = true;
             }
             if (!strncmp(node, "OMGS  ", 6)) {
-                if (get_data_unit(&omgs) != 0)
+                if (get_data_unit_r(vars.p, &omgs) != 0)
                     omgs = 0;
                 isTable = true;
             }
             if (!strncmp(node, "OMGR  ", 6)) {
-                if (get_data_unit(&omgr) != 0)
+                if (get_data_unit_r(vars.p, &omgr) != 0)
                     omgr = 0;
                 isRobot = true;
             }
             if (!strncmp(node, "CHIS  ", 6)) {
-                if (get_data_unit(&chis) != 0)
+                if (get_data_unit_r(vars.p, &chis) != 0)
                     chis = 0;
                 isTable = true;
             }
             if (!strncmp(node, "CHIR  ", 6)) {
-                if (get_data_unit(&chir) != 0)
+                if (get_data_unit_r(vars.p, &chir) != 0)
                     chir = 0;
                 isRobot = true;
             }
             if (!strncmp(node, "PHIS  ", 6)) {
-                if (get_data_unit(&phis) != 0)
+                if (get_data_unit_r(vars.p, &phis) != 0)
                     phis = 0;
                 isTable = true;
             }
             if (!strncmp(node, "PHIR  ", 6)) {
-                if (get_data_unit(&phir) != 0)
+                if (get_data_unit_r(vars.p, &phir) != 0)
                     phir = 0;
                 isRobot = true;
             }
             if (!strncmp(node, "XT    ", 6))
-                if (get_data_unit(&xAxis) != 0)
+                if (get_data_unit_r(vars.p, &xAxis) != 0)
                     xAxis = 0;
             if (!strncmp(node, "XR    ", 6))
-                if (get_data_unit(&xAxis) != 0)
+                if (get_data_unit_r(vars.p, &xAxis) != 0)
                     xAxis = 0;
             if (!strncmp(node, "YT    ", 6))
-                if (get_data_unit(&yAxis) != 0)
+                if (get_data_unit_r(vars.p, &yAxis) != 0)
                     yAxis = 0;
             if (!strncmp(node, "YR    ", 6))
-                if (get_data_unit(&yAxis) != 0)
+                if (get_data_unit_r(vars.p, &yAxis) != 0)
                     yAxis = 0;
             if (!strncmp(node, "ZT    ", 6))
-                if (get_data_unit(&zAxis) != 0)
+                if (get_data_unit_r(vars.p, &zAxis) != 0)
                     zAxis = 0;
             if (!strncmp(node, "ZR    ", 6))
-                if (get_data_unit(&zAxis) != 0)
+                if (get_data_unit_r(vars.p, &zAxis) != 0)
                     zAxis = 0;
             if (!strncmp(node, "PST   ", 6))
-                if (get_data_unit(&pstAxis) != 0)
+                if (get_data_unit_r(vars.p, &pstAxis) != 0)
                     pstAxis = 0;
             if (!strncmp(node, "SST   ", 6))
-                if (get_data_unit(&sstAxis) != 0)
+                if (get_data_unit_r(vars.p, &sstAxis) != 0)
                     sstAxis = 0;
             if (!strncmp(node, "OMGM  ", 6))
-                if (get_data_unit(&omgmAxis) != 0)
+                if (get_data_unit_r(vars.p, &omgmAxis) != 0)
                     omgmAxis = 0;
             if (!strncmp(node, "T     ", 6))
-                if (get_data_unit(&nmT) != 0)
+                if (get_data_unit_r(vars.p, &nmT) != 0)
                     nmT = 0;
             if (!strncmp(node, "TELOAD", 6))
-                if (get_data_unit(&nmTeload) != 0)
+                if (get_data_unit_r(vars.p, &nmTeload) != 0)
                     nmTeload = 0;
             if (!strncmp(node, "TEPOS ", 6))
-                if (get_data_unit(&nmTepos) != 0)
+                if (get_data_unit_r(vars.p, &nmTepos) != 0)
                     nmTepos = 0;
             if (!strncmp(node, "TEEXT ", 6))
-                if (get_data_unit(&nmTeext) != 0)
+                if (get_data_unit_r(vars.p, &nmTeext) != 0)
                     nmTeext = 0;
             if (!strncmp(node, "XE    ", 6))
-                if (get_data_unit(&nmXe) != 0)
+                if (get_data_unit_r(vars.p, &nmXe) != 0)
                     nmXe = 0;
             if (!strncmp(node, "YE    ", 6))
-                if (get_data_unit(&nmYe) != 0)
+                if (get_data_unit_r(vars.p, &nmYe) != 0)
                     nmYe = 0;
             if (!strncmp(node, "ZE    ", 6))
-                if (get_data_unit(&nmZe) != 0)
+                if (get_data_unit_r(vars.p, &nmZe) != 0)
                     nmZe = 0;
             if (!strncmp(node, "MON   ", 6))
-                if (get_data_unit(&mon) != 0)
+                if (get_data_unit_r(vars.p, &mon) != 0)
                     mon = 0;
             if (!strncmp(node, "TIM1  ", 6))
-                if (get_data_unit(&tim1) != 0)
+                if (get_data_unit_r(vars.p, &tim1) != 0)
                     tim1 = 0;
             if (!strncmp(node, "ADET  ", 6)) {
                 if (d_type == 2) {
-                    union {
-                        char ch[MAXNUMBEROFCHANNELS];
-                        int16 i2[MAXNUMBEROFCHANNELS];
-                        int32 i4[MAXNUMBEROFCHANNELS];
-                        int64 i8[MAXNUMBEROFCHANNELS];
-                        float r4[MAXNUMBEROFCHANNELS];
-                        double r8[MAXNUMBEROFCHANNELS];
-                    } buffer;
-
-                    intens = new int[d_number];
-                    imageSize = d_number;
-                    int section = 1;
-                    int start_item = 1;
-                    int tempNumItems, ret_val;
-                    int remaining_items = d_number;
-                    do /* read area detector array in MAXNUMBEROFCHANNELS blocks */
-                    {
-                        if (remaining_items >= MAXNUMBEROFCHANNELS)
-                            tempNumItems = MAXNUMBEROFCHANNELS;
-                        else
-                            tempNumItems = remaining_items;
-                        ret_val = get_data_partition(
-                            buffer.i4, &section, &start_item, &tempNumItems, &d_type);
-                        memmove(
-                            &intens[start_item - 1], buffer.i4, tempNumItems * sizeof(int));
-                        remaining_items -= MAXNUMBEROFCHANNELS;
-                        start_item += MAXNUMBEROFCHANNELS;
-                    } while (!ret_val && (remaining_items > 0));
+                    static_assert(sizeof(int32) == sizeof(float), "in-place conversion");
+                    intens.assign(d_number, 0);
+                    // read area detector array in MAXNUMBEROFCHANNELS blocks, straight into
+                    // the image storage, then convert each block in place from int32 to float
+                    for (int64 done = 0; done < d_number; ) {
+                        const int64 num = qMin<int64>(d_number - done, MAXNUMBEROFCHANNELS);
+                        float* block = intens.data() + done;
+                        if (get_data_partition_r(vars.p, block, 1, done + 1, num, d_type))
+                            break;
+                        for (int64 i = 0; i < num; ++i) {
+                            int32 count;
+                            memcpy(&count, block + i, sizeof(int32));
+                            block[i] = count;
+                        }
+                        done += num;
+                    }
                 }
             }
         }
@@ -563,23 +565,19 @@ QString loadCaressComment(const QString& filePath) {
     QString s_comment;
 
     try {
-        if(open_data_file(filePath.toLocal8Bit().data(), nullptr))
-            THROW("Cannot open data file " + filePath);
-
-        struct CloseFile { // TODO remove, replace with QFile etc.
-            ~CloseFile() { close_data_file(); }
-        } _;
+        const CaressFile vars(filePath);
 
         bool end = false;
         while (!end) {
-            int e_number, e_type, d_type, d_number;
+            int e_number, e_type, d_type;
+            int64 d_number;
             char element[100];
             element[99] = '\0';
             char node[100];
             node[99] = '\0';
 
             int returnNextDataUnit =
-                next_data_unit(&e_number, &e_type, element, node, &d_type, &d_number);
+                next_data_unit_r(vars.p, &e_number, &e_type, element, node, &d_type, &d_number);
             element[8] = '\0';
             node[8] = '\0';
 
@@ -591,7 +589,7 @@ QString loadCaressComment(const QString& filePath) {
 
             if (!strncmp(element, "COM ", 4)) {
                 char* c_comment = new char[d_number + 1];
-                if (get_data_unit(c_comment) != 0)
+                if (get_data_unit_r(vars.p, c_comment) != 0)
                     s_comment = "no comment";
                 else {
                     c_comment[d_number] = '\0'; // terminiere Char-Array
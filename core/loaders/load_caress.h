@@ -12,12 +12,13 @@
 //
 //  ***********************************************************************************************
 
+struct ImageStorage;
 class Rawfile;
 class QString;
 
 namespace load {
 
-Rawfile loadCaress(const QString& filePath);
+Rawfile loadCaress(const QString& filePath, const ImageStorage& storage);
 QString loadCaressComment(const QString& filePath);
 
 }
@@ -14,8 +14,10 @@
 
 #include "core/base/exception.h"
 #include "core/loaders/load_mar.h"
+#include "core/loaders/unpack_pck.h"
 #include "core/raw/rawfile.h"
 #include "3rdparty/Mar/MarReader.h"
+#include <QFile>
 
 namespace load {
 
@@ -23,10 +25,10 @@ namespace load {
 
 //! Called from function load_low_level(..) in file loaders.cpp.
 
-Rawfile loadMar(const QString& filePath) {
+Rawfile loadMar(const QString& filePath, const ImageStorage& storage) {
     typedef short WORD;
 
-    Rawfile ret(filePath);
+    Rawfile ret(filePath, storage);
 
     FILE* fpIn = fopen(filePath.toLocal8Bit().data(), "rb");
     if(!fpIn)
@@ -96,28 +98,42 @@ Rawfile loadMar(const QString& filePath) {
         THROW("bad format");
     }
 
-    WORD* i2_image = new WORD[pixelSize];
-    int* i4_image = new int[pixelSize];
+    std::vector<float> intens(pixelSize);
 
-#define FPOS(a) ((int)(a / 8. + 0.875) * 64)
-    /* Read core of i2_image */
-    /* Go to first record */
+    /* Read core of image */
     if (mar345) {
-        fseek(fpIn, 4096 + FPOS(numberOfHigh), SEEK_SET);
-        get_pck(fpIn, (short*)i2_image);
+        QFile f{filePath};
+        if (!f.open(QFile::ReadOnly))
+            THROW("Cannot open data file " + filePath);
+        const qint64 fileSize = f.size();
+        QByteArray fallback;
+        const uchar* data = f.map(0, fileSize);
+        if (!data) {
+            fallback = f.readAll();
+            if (fallback.size() != fileSize)
+                THROW("Cannot read data file " + filePath);
+            data = reinterpret_cast<const uchar*>(fallback.constData());
+        }
+        int width, height;
+        const qint64 start = findPck(data, fileSize, width, height);
+        if (start < 0)
+            THROW("bad format: packed image not found");
+        if (qint64(width) * height != pixelSize)
+            THROW("bad format: inconsistent size of packed image");
+        unpackPck(data + start, fileSize - start, width, height, intens.data());
     } else {
+        std::vector<WORD> i2_image(pixelSize);
         fseek(fpIn, pixSizeX + pixSizeY, SEEK_SET);
-        int i = (int)fread((unsigned char*)i2_image, sizeof(short), pixelSize, fpIn);
-        if (i != (int)pixelSize)
+        const int numRead = (int)fread(
+            (unsigned char*)i2_image.data(), sizeof(short), pixelSize, fpIn);
+        if (numRead != (int)pixelSize)
             THROW("did not read not all pixels"); // Does this happen? Would a warning suffice?
         if (byteswap)
-            swapint16((unsigned char*)i2_image, pixelSize * sizeof(WORD));
+            swapint16((unsigned char*)i2_image.data(), pixelSize * sizeof(WORD));
+        for (int i=0; i<pixelSize; ++i)
+            intens[i] = (unsigned short)i2_image[i];
     }
 
-    // Copy to 32Bit-Array
-    for (int i=0; i<pixelSize; ++i)
-        i4_image[i] = (int)((unsigned short)i2_image[i]);
-
     //***********************************
     //*** Read and correct high bytes ***
     //***********************************
@@ -158,7 +174,7 @@ Rawfile loadMar(const QString& filePath) {
                 pair[1] = 128000;
 
             // Correct high pixel
-            i4_image[address] = pair[1];
+            intens[address] = pair[1];
         }
     }
 
@@ -198,12 +214,6 @@ Rawfile loadMar(const QString& filePath) {
         totalTime += exposureTime;
     }
 
-    size2d size(pixSizeX, pixSizeY);
-    std::vector<float> convertedIntens(pixelSize);
-
-    for (int i=0; i<pixelSize; ++i)
-        convertedIntens[i] = float(i4_image[i]);
-
     Metadata md;
 
     md.set("omega", deg{omega});
@@ -217,10 +227,7 @@ Rawfile loadMar(const QString& filePath) {
 
     // REVIEW ?? pictureOverflow
 
-    ret.addDataset(std::move(md), size2d(pixSizeX, pixSizeY), std::move(convertedIntens));
-
-    delete[] i2_image;
-    delete[] i4_image;
+    ret.addDataset(std::move(md), size2d(pixSizeX, pixSizeY), std::move(intens));
 
     return ret;
 }
@@ -12,11 +12,12 @@
 //
 //  ***********************************************************************************************
 
+struct ImageStorage;
 class Rawfile;
 class QString;
 
 namespace load {
 
-Rawfile loadMar(const QString& filePath);
+Rawfile loadMar(const QString& filePath, const ImageStorage& storage);
 
 }
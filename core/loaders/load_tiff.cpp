@@ -14,15 +14,63 @@
 
 #include "qcr/base/string_ops.h"
 #include "core/base/exception.h"
+#include "core/base/parallel.h"
 #include "core/raw/rawfile.h"
-#include <QDataStream>
 #include <QDir>
+#include <QtEndian>
+#include <cstring>
+#include <exception>
+#include <memory>
 
 namespace {
 
-//! Reads one TIFF file.
-static void loadTiff(
-    Rawfile* file, const QString& filePath, deg phi, double monitor, double expTime)
+//! Returns a raw sample, converted to the type T of the same width as U.
+template<typename T, typename U>
+inline float sampleValue(U raw) { return static_cast<T>(raw); }
+
+template<>
+inline float sampleValue<float, quint32>(quint32 raw)
+{
+    float ret;
+    memcpy(&ret, &raw, sizeof(ret));
+    return ret;
+}
+
+//! Converts n samples of type T, stored with byte order of the file, into floats.
+
+//! U is the unsigned integer type of the same width as T. Written as plain loops over
+//! unaligned loads, which compilers vectorize.
+
+template<typename T, typename U>
+void decodeSamples(const uchar* src, int n, bool bigEndian, float* dst)
+{
+    static_assert(sizeof(T) == sizeof(U), "sample type and raw type must have same width");
+    if (bigEndian)
+        for (int i=0; i<n; ++i)
+            dst[i] = sampleValue<T,U>(qFromBigEndian<U>(src + i * sizeof(U)));
+    else
+        for (int i=0; i<n; ++i)
+            dst[i] = sampleValue<T,U>(qFromLittleEndian<U>(src + i * sizeof(U)));
+}
+
+//! Metadata and intensities of one TIFF file.
+struct TiffImage {
+    Metadata md;
+    size2d size;
+    std::vector<float> intens;
+};
+
+//! One line of a .dat file.
+struct TiffEntry {
+    int iline;
+    QString fileName;
+    deg phi;
+    double monitor;
+    double expTime;
+};
+
+//! Reads one TIFF file. Thread safe.
+static TiffImage loadTiff(const QString& filePath, deg phi, double monitor, double expTime)
 {
     Metadata md;
     md.set("phi", phi);
@@ -35,73 +83,102 @@ static void loadTiff(
     if (!(f.open(QFile::ReadOnly)))
         THROW("Cannot open file");
 
-    QDataStream is(&f);
-    is.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    const qint64 fileSize = f.size();
+    QByteArray fallback;
+    const uchar* data = f.map(0, fileSize);
+    if (!data) { // mapping may fail, e.g. on some network file systems
+        fallback = f.readAll();
+        if (fallback.size() != fileSize)
+            THROW("Could not read data from file");
+        data = reinterpret_cast<const uchar*>(fallback.constData());
+    }
 
-    auto check = [&is]() {
-                     if (!(QDataStream::Ok == is.status()))
-                         THROW("Could not read data from file"); };
+    auto checkRange = [fileSize](qint64 offset, qint64 length) {
+                          if (offset < 0 || length < 0 || offset + length > fileSize)
+                              THROW("Bad offset"); };
 
     // magic
-    qint16 magic;
-    is >> magic;
-
-    if (0x4949 == magic) // II - intel
-        is.setByteOrder(QDataStream::LittleEndian);
-    else if (0x4d4d == magic) // MM - motorola
-        is.setByteOrder(QDataStream::BigEndian);
+    checkRange(0, 8);
+    bool bigEndian;
+    if (data[0] == 'I' && data[1] == 'I') // intel
+        bigEndian = false;
+    else if (data[0] == 'M' && data[1] == 'M') // motorola
+        bigEndian = true;
     else
         THROW("Bad magic bytes - not a TIFF file?");
 
-    qint16 version;
-    is >> version;
-    if (42 != version)
-        THROW("Bad version code");
+    auto get16 = [&](qint64 offset) -> quint32 {
+        checkRange(offset, 2);
+        return bigEndian ? qFromBigEndian<quint16>(data + offset)
+                         : qFromLittleEndian<quint16>(data + offset); };
+    auto get32 = [&](qint64 offset) -> quint32 {
+        checkRange(offset, 4);
+        return bigEndian ? qFromBigEndian<quint32>(data + offset)
+                         : qFromLittleEndian<quint32>(data + offset); };
 
-    qint32 imageWidth = 0, imageHeight = 0, bitsPerSample = 0, sampleFormat = 0,
-            rowsPerStrip = 0xffffffff, stripOffsets = 0, stripByteCounts = 0;
+    if (42 != get16(2))
+        THROW("Bad version code");
 
-    qint16 tagId, dataType;
-    qint32 dataCount, dataOffset;
+    quint32 imageWidth = 0, imageHeight = 0, bitsPerSample = 0, sampleFormat = 1,
+            rowsPerStrip = 0xffffffff;
+    std::vector<quint32> stripOffsets, stripByteCounts;
 
-    auto seek = [&f](qint64 offset) { if (!(f.seek(offset))) THROW("Bad offset"); };
+    // directory entry: tag id, data type, data count, and value or offset of values
+    quint32 dataType, dataCount;
+    qint64 entryValuePos;
 
-    auto asUint = [&]() -> int {
-        if (dataCount!=1)
-            THROW("Bad data count");
+    auto typeSize = [&]() -> int {
         switch (dataType) {
-        case 1: // byte
-            return dataOffset & 0x000000ff; // some tif files did have trash there
-        case 3: // short
-            return dataOffset & 0x0000ffff;
-        case 4: return dataOffset;
+        case 1: case 2: return 1; // byte, ascii
+        case 3: return 2; // short
+        case 4: return 4; // long
         }
         THROW("Invalid entry - not a simple number");
     };
 
+    // position of the values, which are stored in place if they fit into 4 bytes
+    auto valuesPos = [&]() -> qint64 {
+        return dataCount * typeSize() <= 4 ? entryValuePos : get32(entryValuePos); };
+
+    auto asUints = [&]() -> std::vector<quint32> {
+        if (dataType == 2)
+            THROW("Invalid entry - not a simple number");
+        const qint64 pos = valuesPos();
+        checkRange(pos, qint64(dataCount) * typeSize());
+        std::vector<quint32> ret(dataCount);
+        for (quint32 i=0; i<dataCount; ++i)
+            switch (dataType) {
+            case 1: ret[i] = data[pos + i]; break;
+            case 3: ret[i] = get16(pos + 2 * i); break;
+            case 4: ret[i] = get32(pos + 4 * i); break;
+            }
+        return ret;
+    };
+
+    auto asUint = [&]() -> quint32 {
+        if (dataCount!=1)
+            THROW("Bad data count");
+        return asUints().front();
+    };
+
     auto asStr = [&]()->QString {
         if (dataType!=2)
             THROW("Invalid entry - not a string");
-        auto lastPos = f.pos();
-
-        seek(dataOffset);
-        QByteArray data = f.readLine(dataCount);
-        seek(lastPos);
-
-        return QString(data);
+        const qint64 pos = valuesPos();
+        checkRange(pos, dataCount);
+        const char* str = reinterpret_cast<const char*>(data + pos);
+        return QString::fromLatin1(str, qstrnlen(str, dataCount));
     };
 
-    qint32 dirOffset;
-    is >> dirOffset;
-    check();
-    seek(dirOffset);
-
-    qint16 numDirEntries;
-    is >> numDirEntries;
+    const qint64 dirOffset = get32(4);
+    const int numDirEntries = get16(dirOffset);
 
     for (int i=0; i<numDirEntries; ++i) {
-        is >> tagId >> dataType >> dataCount >> dataOffset;
-        check();
+        const qint64 entryPos = dirOffset + 2 + 12 * i;
+        const quint32 tagId = get16(entryPos);
+        dataType = get16(entryPos + 2);
+        dataCount = get32(entryPos + 4);
+        entryValuePos = entryPos + 8;
 
         switch (tagId) {
         // numbers
@@ -112,15 +189,17 @@ static void loadTiff(
             if (asUint()!=1)
                 THROW("Unsupported flag value (compression=on)");
             break;
-        case 273: stripOffsets = asUint(); break;
+        case 273: stripOffsets = asUints(); break;
         case 277: // SamplesPerPixel
             if (asUint()!=1)
                 THROW("Unsupported flag value (samplePerPixel!=1");
+            break;
         case 278: rowsPerStrip = asUint(); break;
-        case 279: stripByteCounts = asUint(); break;
+        case 279: stripByteCounts = asUints(); break;
         case 284: // PlanarConfiguration
             if (asUint()!=1)
                 THROW("Unsupported flag value (planar=off)");
+            break;
         case 339:
             sampleFormat = asUint(); // 1 unsigned, 2 signed, 3 IEEE
             break;
@@ -138,58 +217,51 @@ static void loadTiff(
         }
     }
 
-    if (imageWidth<=0)
+    if (imageWidth<=0 || imageWidth>0x10000)
         THROW("cannot read TIFF: unexpected imageWidth");
-    if (imageHeight<=0)
+    if (imageHeight<=0 || imageHeight>0x10000)
         THROW("cannot read TIFF: unexpected imageHeight");
-    if (stripOffsets<=0)
-        THROW("cannot read TIFF: unexpected stripOffsets");
-    if (stripByteCounts<=0)
-        THROW("cannot read TIFF: unexpected stripByteCounts");
-    if (imageHeight < rowsPerStrip)
-        THROW("cannot read TIFF: imageHeight >= rowsPerStrip");
+    if (rowsPerStrip<=0)
+        THROW("cannot read TIFF: unexpected rowsPerStrip");
+    rowsPerStrip = qMin(rowsPerStrip, imageHeight);
+    const quint32 numStrips = (imageHeight + rowsPerStrip - 1) / rowsPerStrip;
+    if (stripOffsets.size() != numStrips)
+        THROW("cannot read TIFF: unexpected number of stripOffsets");
+    if (stripByteCounts.size() != numStrips)
+        THROW("cannot read TIFF: unexpected number of stripByteCounts");
 
     if (sampleFormat<1 || sampleFormat>3)
         THROW("cannot read TIFF: unexpected sampleFormat");
-    if (bitsPerSample!=32)
-        THROW("cannot read TIFF: bitsPerSample!=32");
-
+    if (sampleFormat==3 ? bitsPerSample!=32
+        : bitsPerSample!=8 && bitsPerSample!=16 && bitsPerSample!=32)
+        THROW("cannot read TIFF: unsupported bitsPerSample");
 
     size2d size(imageWidth, imageHeight);
 
-    int count = imageWidth * imageHeight;
+    const int count = imageWidth * imageHeight;
     std::vector<float> intens(count);
 
-    if (!((bitsPerSample / 8) * count == stripByteCounts))
-        THROW("cannot read TIFF: unexpected bitsPerSample");
-
-    seek(stripOffsets);
-
-    for (int i=0; i<intens.size(); ++i)
-        switch (sampleFormat) {
-        case 1: {
-            qint32 sample;
-            is >> sample;
-            intens[i] = sample;
-            break;
+    const int bytesPerSample = bitsPerSample / 8;
+    for (quint32 iStrip=0; iStrip<numStrips; ++iStrip) {
+        const int row0 = iStrip * rowsPerStrip;
+        const int n = qMin(rowsPerStrip, imageHeight - row0) * imageWidth;
+        if (stripByteCounts[iStrip] < quint32(n * bytesPerSample))
+            THROW("cannot read TIFF: unexpected stripByteCounts");
+        checkRange(stripOffsets[iStrip], n * bytesPerSample);
+        const uchar* src = data + stripOffsets[iStrip];
+        float* dst = intens.data() + row0 * imageWidth;
+        switch (sampleFormat * 100 + bitsPerSample) {
+        case 108: decodeSamples<quint8,  quint8 >(src, n, bigEndian, dst); break;
+        case 116: decodeSamples<quint16, quint16>(src, n, bigEndian, dst); break;
+        case 132: decodeSamples<quint32, quint32>(src, n, bigEndian, dst); break;
+        case 208: decodeSamples<qint8,   quint8 >(src, n, bigEndian, dst); break;
+        case 216: decodeSamples<qint16,  quint16>(src, n, bigEndian, dst); break;
+        case 232: decodeSamples<qint32,  quint32>(src, n, bigEndian, dst); break;
+        case 332: decodeSamples<float,   quint32>(src, n, bigEndian, dst); break;
         }
-        case 2: {
-            qint32 sample;
-            is >> sample;
-            intens[i] = sample;
-            break;
-        }
-        case 3: {
-            float sample;
-            is >> sample;
-            intens[i] = sample;
-            break;
-        }
-        }
-
-    check();
+    }
 
-    file->addDataset(std::move(md), size, std::move(intens));
+    return {std::move(md), size, std::move(intens)};
 }
 
 } // namespace
@@ -219,8 +291,8 @@ namespace load {
 //! Aus-Weimin-00008.tif -55
 //! Aus-Weimin-00009.tif -50
 
-Rawfile loadTiffDat(const QString& filePath) {
-    Rawfile ret(filePath);
+Rawfile loadTiffDat(const QString& filePath, const ImageStorage& storage) {
+    Rawfile ret(filePath, storage);
 
     if (filePath=="")
         qFatal("BUG: call of loadTiffDat with empty argument");
@@ -231,55 +303,89 @@ Rawfile loadTiffDat(const QString& filePath) {
 
     QDir dir = QFileInfo(filePath).dir();
 
+    // parse the list; an error is thrown after the images listed before it are loaded
+    std::vector<TiffEntry> entries;
+    std::exception_ptr listFailure;
     QByteArray line;
     int iline = 0;
-    while (!(line = f.readLine()).isEmpty()) {
-        ++iline;
-        QString s = line;
-
-        // cut off comment
-        int commentPos = s.indexOf(';');
-        if (commentPos >= 0)
-            s = s.left(commentPos);
-
-        // split to parts
-        if ((s = s.simplified()).isEmpty())
-            continue;
-
-        const QStringList lst = s.split(' ');
-        const int cnt = lst.count();
-        if (cnt<2 || cnt>4)
-            THROW("File "+filePath+": bad metadata format");
-
-        // file, phi, monitor, expTime
-        bool ok;
-        QString tiffFileName = lst.at(0);
-        deg phi = lst.at(1).toDouble(&ok);
-        if (!(ok))
-            THROW("File "+filePath+": bad phi value");
-
-        double monitor = 0;
-        if (cnt > 2) {
-            monitor = lst.at(2).toDouble(&ok);
+    try {
+        while (!(line = f.readLine()).isEmpty()) {
+            ++iline;
+            QString s = line;
+
+            // cut off comment
+            int commentPos = s.indexOf(';');
+            if (commentPos >= 0)
+                s = s.left(commentPos);
+
+            // split to parts
+            if ((s = s.simplified()).isEmpty())
+                continue;
+
+            const QStringList lst = s.split(' ');
+            const int cnt = lst.count();
+            if (cnt<2 || cnt>4)
+                THROW("File "+filePath+": bad metadata format");
+
+            // file, phi, monitor, expTime
+            bool ok;
+            QString tiffFileName = lst.at(0);
+            deg phi = lst.at(1).toDouble(&ok);
             if (!(ok))
-                THROW("File "+filePath+": bad monitor value");
-        }
-
-        double expTime = 0;
-        if (cnt > 3) {
-            expTime = lst.at(3).toDouble(&ok);
-            if (!(ok))
-                THROW("File "+filePath+": bad expTime value");
+                THROW("File "+filePath+": bad phi value");
+
+            double monitor = 0;
+            if (cnt > 2) {
+                monitor = lst.at(2).toDouble(&ok);
+                if (!(ok))
+                    THROW("File "+filePath+": bad monitor value");
+            }
+
+            double expTime = 0;
+            if (cnt > 3) {
+                expTime = lst.at(3).toDouble(&ok);
+                if (!(ok))
+                    THROW("File "+filePath+": bad expTime value");
+            }
+
+            entries.push_back({iline, tiffFileName, phi, monitor, expTime});
         }
+    } catch (const Exception&) {
+        listFailure = std::current_exception();
+    }
 
-        try {
-            // load one dataseq
-            loadTiff(&ret, dir.filePath(tiffFileName), phi, monitor, expTime);
-        } catch (const Exception& ex) {
-            THROW("File "+filePath+": cannot load image number "+strOp::to_s(iline)
-                  +" ("+tiffFileName + "): " + ex.msg());
+    // load the images concurrently, in windows of one image per thread, so that only a few
+    // decoded images are in memory at a time; add them in the order listed, and report the
+    // first error
+    const int n = entries.size();
+    const int window = parallel::numThreads();
+    for (int windowBegin=0; windowBegin<n; windowBegin+=window) {
+        const int count = qMin(window, n - windowBegin);
+        std::vector<std::unique_ptr<TiffImage>> images(count);
+        std::vector<std::exception_ptr> failures(count);
+        parallel::forChunks(count, [&](int, int begin, int end) {
+            for (int k=begin; k<end; ++k) {
+                const TiffEntry& entry = entries[windowBegin + k];
+                try {
+                    images[k].reset(new TiffImage {loadTiff(
+                        dir.filePath(entry.fileName), entry.phi, entry.monitor, entry.expTime)});
+                } catch (const Exception& ex) {
+                    failures[k] = std::make_exception_ptr(Exception {
+                            "File "+filePath+": cannot load image number "
+                            +strOp::to_s(entry.iline)+" ("+entry.fileName + "): " + ex.msg()});
+                }
+            }
+        });
+        for (int k=0; k<count; ++k) {
+            if (failures[k])
+                std::rethrow_exception(failures[k]);
+            TiffImage& image = *images[k];
+            ret.addDataset(std::move(image.md), image.size, std::move(image.intens));
+            images[k].reset();
         }
     }
+    if (listFailure)
+        std::rethrow_exception(listFailure);
 
     return ret;
 }
@@ -12,11 +12,12 @@
 //
 //  ***********************************************************************************************
 
+struct ImageStorage;
 class Rawfile;
 class QString;
 
 namespace load {
 
-Rawfile loadTiffDat(const QString& filePath);
+Rawfile loadTiffDat(const QString& filePath, const ImageStorage& storage);
 
 }
@@ -17,75 +17,250 @@
 #include "core/raw/rawfile.h"
 #include "core/base/exception.h"
 #include "qcr/base/debug.h"
-#include <functional>
+#include <algorithm>
+#include <cstring>
+#include <vector>
 
 namespace  {
 
-using loadYAML::YamlNode;
+using loadYAML::YamlEvents;
 
-void readSample(const YamlNode& node, Metadata& metadata)
+enum class Kind { STRING, DOUBLE, DEG };
+
+//! A metadata value, to be read from the YAML node at the given key path.
+struct Field {
+    const char* path;
+    const char* key;
+    Kind kind;
+};
+
+//! Fields of the sections "history", "sample", "setup" of the "measurement" section.
+const std::vector<Field> headerFields = {
+    {"history.started",               "date",      Kind::STRING},
+    {"history.scan",                  "comment",   Kind::STRING},
+    {"sample.position.xt.value",      "X",         Kind::DOUBLE},
+    {"sample.position.yt.value",      "Y",         Kind::DOUBLE},
+    {"sample.position.zt.value",      "Z",         Kind::DOUBLE},
+    {"sample.orientation.omgs.value", "omega",     Kind::DEG},
+    {"sample.orientation.tths.value", "mid2theta", Kind::DEG},
+    {"sample.orientation.phis.value", "phi",       Kind::DEG},
+    {"sample.orientation.chis.value", "chi",       Kind::DEG},
+    {"setup.monochromator.omgm.value","OmegaM",    Kind::DEG},
+};
+
+//! Fields of each entry in the list "measurement.scan", besides the image.
+const std::vector<Field> scanFields = {
+    {"time",    "t",   Kind::DOUBLE},
+    {"monitor", "mon", Kind::DOUBLE},
+};
+
+const char* const headerSections[] = {"history", "sample", "setup"};
+
+//! Sets the keys of all given fields to empty values, so that they exist even if missing in
+//! the file.
+void presetFields(Mapped& target, const std::vector<Field>& fields)
 {
-    metadata.set("X", node["position"]["xt"]["value"].doubleValue(Q_QNAN));
-    metadata.set("Y", node["position"]["yt"]["value"].doubleValue(Q_QNAN));
-    metadata.set("Z", node["position"]["zt"]["value"].doubleValue(Q_QNAN));
-    metadata.set("omega", deg{node["orientation"]["omgs"]["value"].doubleValue(Q_QNAN)});
-    metadata.set("mid2theta", deg{node["orientation"]["tths"]["value"].doubleValue(Q_QNAN)});
-    metadata.set("phi", deg{node["orientation"]["phis"]["value"].doubleValue(Q_QNAN)});
-    metadata.set("chi", deg{node["orientation"]["chis"]["value"].doubleValue(Q_QNAN)});
+    for (const Field& field : fields)
+        if (field.kind == Kind::STRING)
+            target.set(field.key, QString());
+        else if (field.kind == Kind::DEG)
+            target.set(field.key, deg{Q_QNAN});
+        else
+            target.set(field.key, Q_QNAN);
 }
 
-void readSetup(const YamlNode& node, Metadata& metadata)
+//! Metadata and image of one scan.
+struct Scan {
+    Mapped values;
+    loadYAML::YamlArray2d image;
+};
+
+//! Walks the event stream of a YAML file, and adds each scan to the rawfile once it is read.
+
+//! Only the values listed in headerFields and scanFields are read; all other nodes are skipped.
+//! Scans are normally preceded by the header sections; otherwise they are held back until the
+//! end of the "measurement" section.
+
+class YamlReader {
+public:
+    YamlReader(YamlEvents& events, Rawfile& rawfile);
+    void readDocument();
+
+private:
+    void readMeasurement();
+    void readHeaderNode(const std::string& path);
+    void readScans();
+    Scan readScan();
+    void addScan(Scan&& scan);
+    void setValue(Mapped& target, const Field& field);
+    std::string nextKey(); //!< Returns next key of current map, or empty string at its end.
+
+    YamlEvents& events_;
+    Rawfile& rawfile_;
+    Mapped header_;
+    int numHeaderSections_ {0}; //!< number of header sections read so far
+    std::vector<Scan> pending_; //!< scans read before the header was complete
+};
+
+YamlReader::YamlReader(YamlEvents& events, Rawfile& rawfile)
+    : events_{events}
+    , rawfile_{rawfile}
 {
-    metadata.set("PST", Q_QNAN); // node["orientation"]["pst"]["value"].doubleValue(Q_QNAN);
-    metadata.set("SST", Q_QNAN); // node["orientation"]["sst"]["value"].doubleValue(Q_QNAN);
-    metadata.set("OmegaM", deg{node["monochromator"]["omgm"]["value"].doubleValue(Q_QNAN)});
-    metadata.set("T", Q_QNAN);
-    metadata.set("teload", Q_QNAN);
-    metadata.set("tepos", Q_QNAN);
-    metadata.set("teext", Q_QNAN);
-    metadata.set("xe", Q_QNAN);
-    metadata.set("ye", Q_QNAN);
-    metadata.set("ze", Q_QNAN);
+    presetFields(header_, headerFields);
+    for (const char* key : {"PST", "SST", "T", "teload", "tepos", "teext", "xe", "ye", "ze"})
+        header_.set(key, Q_QNAN);
 }
 
-void readSingleScan(const YamlNode& node, Metadata& metadata, Rawfile& rawfile)
+//! Reads the first document. For the time being, the "instrument", "format", and "experiment"
+//! sections are ignored for good; only the "measurement" section is read.
+void YamlReader::readDocument()
 {
-    metadata.set("t", node["time"].doubleValue(Q_QNAN));
-    metadata.set("mon", node["monitor"].doubleValue(Q_QNAN));
-    const auto image      = node["image"].array2dValue();
-
-    const size2d size(image->width, image->height);
+    if (events_.next().type != YAML_STREAM_START_EVENT
+        || events_.next().type != YAML_DOCUMENT_START_EVENT
+        || events_.next().type != YAML_MAPPING_START_EVENT)
+        THROW("invalid YAML format: document should be a map, but isn't.");
+    bool found = false;
+    for (std::string key = nextKey(); !key.empty(); key = nextKey()) {
+        events_.next();
+        if (key == "measurement") {
+            readMeasurement();
+            found = true;
+        } else
+            events_.skip();
+    }
+    if (!found)
+        THROW("invalid YAML format: 'measurement' section is missing.");
+}
 
-    rawfile.addDataset(std::move(metadata), size, std::move(image->data));
+void YamlReader::readMeasurement()
+{
+    if (events_.type() != YAML_MAPPING_START_EVENT)
+        THROW("invalid YAML format: 'measurement' section should be a map, but isn't.");
+    for (std::string key = nextKey(); !key.empty(); key = nextKey()) {
+        events_.next();
+        if (key == "scan") {
+            readScans();
+        } else if (std::find(std::begin(headerSections), std::end(headerSections), key)
+                   != std::end(headerSections)) {
+            readHeaderNode(key);
+            if (++numHeaderSections_ == 3) {
+                for (Scan& scan : pending_)
+                    addScan(std::move(scan));
+                pending_.clear();
+            }
+        } else
+            events_.skip();
+    }
+    numHeaderSections_ = 3; // incomplete header: the remaining fields stay NaN
+    for (Scan& scan : pending_)
+        addScan(std::move(scan));
+    pending_.clear();
 }
 
-void readScans(const YamlNode& node, Metadata& metadata, Rawfile& rawfile)
+//! Reads the node at given path, which is a prefix of one or several header field paths.
+void YamlReader::readHeaderNode(const std::string& path)
 {
-    if (!node.isSequence())
-        THROW("invalid YAML format: 'measurement.scan' section should be a list, but isn't.")
-    for (const YamlNode& innerNode: node) {
-        Metadata metadataCopy(std::move(metadata));
-        // Copy the QStrings back, because std::move removes them from metadata:
-        if (metadataCopy.has("date"))
-            metadata.set("date", metadataCopy.get<QString>("date"));
-        if (metadataCopy.has("comment"))
-            metadata.set("comment", metadataCopy.get<QString>("comment"));
-        readSingleScan(innerNode, metadataCopy, rawfile);
+    if (events_.type() == YAML_SCALAR_EVENT) {
+        for (const Field& field : headerFields)
+            if (path == field.path)
+                setValue(header_, field);
+        return;
+    }
+    if (events_.type() != YAML_MAPPING_START_EVENT) {
+        events_.skip();
+        return;
+    }
+    for (std::string key = nextKey(); !key.empty(); key = nextKey()) {
+        events_.next();
+        const std::string subpath = path + "." + key;
+        const bool wanted = std::any_of(
+            headerFields.begin(), headerFields.end(), [&subpath](const Field& field) {
+                return !strncmp(field.path, subpath.c_str(), subpath.size())
+                    && (field.path[subpath.size()] == '\0' || field.path[subpath.size()] == '.');
+            });
+        if (wanted)
+            readHeaderNode(subpath);
+        else
+            events_.skip();
     }
 }
 
-//! Processes the "measurement" section of the Yaml tree, and inserts contents into rawfile.
+void YamlReader::readScans()
+{
+    if (events_.type() != YAML_SEQUENCE_START_EVENT)
+        THROW("invalid YAML format: 'measurement.scan' section should be a list, but isn't.");
+    while (events_.next().type != YAML_SEQUENCE_END_EVENT)
+        addScan(readScan());
+}
 
-void readMeasurement(const YamlNode& node, Rawfile& rawfile)
+Scan YamlReader::readScan()
 {
+    if (events_.type() != YAML_MAPPING_START_EVENT)
+        THROW("invalid YAML format: entry of 'measurement.scan' should be a map, but isn't.");
+    Scan ret;
+    presetFields(ret.values, scanFields);
+    bool hasImage = false;
+    for (std::string key = nextKey(); !key.empty(); key = nextKey()) {
+        events_.next();
+        if (key == "image") {
+            if (!events_.hasTag("!array2d"))
+                THROW("invalid YAML format: scan image should be tagged !array2d, but isn't.");
+            const yaml_event_t& event = events_.current();
+            loadYAML::parseArray2d(reinterpret_cast<const char*>(event.data.scalar.value),
+                                   event.data.scalar.length, ret.image);
+            hasImage = true;
+            continue;
+        }
+        auto field = std::find_if(scanFields.begin(), scanFields.end(), [&key](const Field& f) {
+                return key == f.path; });
+        if (field != scanFields.end() && events_.type() == YAML_SCALAR_EVENT)
+            setValue(ret.values, *field);
+        else
+            events_.skip();
+    }
+    if (!hasImage)
+        THROW("invalid YAML format: scan has no image.");
+    return ret;
+}
+
+void YamlReader::addScan(Scan&& scan)
+{
+    if (numHeaderSections_ < 3) {
+        pending_.push_back(std::move(scan));
+        return;
+    }
     Metadata metadata;
+    metadata.insert(&header_);
+    metadata.insert(&scan.values);
+    const size2d size(scan.image.width, scan.image.height);
+    rawfile_.addDataset(std::move(metadata), size, std::move(scan.image.data));
+}
 
-    metadata.set("date", node["history"]["started"].value());
-    metadata.set("comment", node["history"]["scan"].value());
+void YamlReader::setValue(Mapped& target, const Field& field)
+{
+    const QString value = QString::fromStdString(events_.scalar());
+    if (field.kind == Kind::STRING) {
+        target.set(field.key, value);
+        return;
+    }
+    bool ok = false;
+    double d = value.toDouble(&ok);
+    if (!ok)
+        d = Q_QNAN;
+    if (field.kind == Kind::DEG)
+        target.set(field.key, deg{d});
+    else
+        target.set(field.key, d);
+}
 
-    readSample(node["sample"], metadata);
-    readSetup(node["setup"], metadata);
-    readScans(node["scan"], metadata, rawfile); // adds the scans to the rawfile
+std::string YamlReader::nextKey()
+{
+    if (events_.next().type == YAML_MAPPING_END_EVENT)
+        return {};
+    std::string ret = events_.scalar();
+    if (ret.empty())
+        THROW("invalid YAML format: empty key.");
+    return ret;
 }
 
 } // namespace
@@ -97,18 +272,12 @@ namespace load {
 //!
 //! Called from function load_low_level(..) in file loaders.cpp.
 
-Rawfile loadYaml(const QString& filePath)
+Rawfile loadYaml(const QString& filePath, const ImageStorage& storage)
 {
     try {
-        qDebug() << "DEBUG[load_yaml] now load file";
-        YamlNode yamlTree = loadYAML::loadYamlFast(filePath.toStdString()); // throws
-        qDebug() << "DEBUG[load_yaml] file loaded, now processing tree";
-
-        Rawfile rawfile(filePath); // sets file name, otherwise rawfile is tabula rasa.
-        // for the time being, the "instrument", "format", and "experiment" scetions
-        // of yamlTree are ignored for good; only the "measurement" section is read:
-        readMeasurement(yamlTree["measurement"], rawfile);
-        qDebug() << "DEBUG[load_yaml] tree processed, now returning rawfile";
+        Rawfile rawfile(filePath, storage); // sets file name, otherwise rawfile is tabula rasa.
+        YamlEvents events(filePath.toStdString()); // throws
+        YamlReader(events, rawfile).readDocument();
         return rawfile;
     } catch (const Exception& ex) {
         THROW("Invalid data in file "+filePath+": " + ex.msg());
@@ -12,11 +12,12 @@
 //
 //  ***********************************************************************************************
 
+struct ImageStorage;
 class Rawfile;
 class QString;
 
 namespace load {
 
-Rawfile loadYaml(const QString& filePath);
+Rawfile loadYaml(const QString& filePath, const ImageStorage& storage);
 
 }
@@ -17,6 +17,7 @@
 #include "core/loaders/load_mar.h"    // provides load::loadMar(..)
 #include "core/loaders/load_tiff.h"   // provides load::loadTiff(..)
 #include "core/loaders/load_yaml.h"   // provides load::loadYaml(..)
+#include "core/loaders/rawfile_cache.h"
 #include "core/raw/rawfile.h"
 #include <QStringBuilder> // for ".." % ..
 
@@ -69,19 +70,19 @@ bool couldBeTiffDat(const QFileInfo& info) {
     return ret;
 }
 
-Rawfile load_low_level(const QString& filePath) {
+Rawfile load_low_level(const QString& filePath, const ImageStorage& storage) {
     const QFileInfo info(filePath);
     if (!(info.exists()))
         THROW("File '" % filePath % "' does not exist");
 
     if (couldBeCaress(info))
-        return load::loadCaress(filePath);
+        return load::loadCaress(filePath, storage);
     else if (couldBeYaml(info))
-        return load::loadYaml(filePath);
+        return load::loadYaml(filePath, storage);
     else if (couldBeMar(info))
-        return load::loadMar(filePath);
+        return load::loadMar(filePath, storage);
     else if (couldBeTiffDat(info))
-        return load::loadTiffDat(filePath);
+        return load::loadTiffDat(filePath, storage);
     else
         THROW("File '" % filePath % "' has unknown type");
 }
@@ -94,11 +95,34 @@ namespace load {
 
 //! The file type (format) will be determined automatically,
 //! and the corresponding loader will be called.
-
-Rawfile loadRawfile(const QString& filePath) {
-    Rawfile ret {load_low_level(filePath)};
+//! If the raw file cache is enabled, and the file was loaded before and is unchanged, it is
+//! read from the cache instead; otherwise, it is written to the cache.
+//! If pool is given, only metadata are kept in memory, and the pool decides how many images
+//! stay resident. While loading, the images are written one by one to the cache file, or to
+//! a temporary file if the cache is disabled; they are read from that file on demand, which
+//! stays open as long as the measurements exist.
+//! Otherwise, storage determines where and in which form images are kept.
+
+Rawfile loadRawfile(const QString& filePath, ImagePool* pool, const ImageStorage& storage,
+                    const RawfileCacheSettings& cache) {
+    Rawfile cached(filePath, storage);
+    if (readRawfileCache(cached, cache, pool))
+        return cached;
+    if (pool) {
+        RawfileSpill spill(QFileInfo(filePath), cache);
+        ImageStorage spilling = storage;
+        spilling.sink = &spill;
+        load_low_level(filePath, spilling);
+        if (!spill.count())
+            THROW("File '" % filePath % "' contains no cluster");
+        Rawfile ret(filePath);
+        spill.finish(ret, pool);
+        return ret;
+    }
+    Rawfile ret {load_low_level(filePath, storage)};
     if (!ret.numMeasurements())
         THROW("File '" % filePath % "' contains no cluster");
+    writeRawfileCache(ret, cache);
     return ret;
 }
 
@@ -15,14 +15,16 @@
 #ifndef LOADERS_H
 #define LOADERS_H
 
+#include "core/loaders/rawfile_cache.h"
 #include "core/raw/rawfile.h"
 
 //! Functions loadRawfile and loadComment, and their dependences.
 
 namespace load {
 
-//! Loads a raw file of any supported type.
-Rawfile loadRawfile(const QString& filePath);
+//! Loads a raw file of any supported type; if pool is given, images are loaded on demand.
+Rawfile loadRawfile(const QString& filePath, ImagePool* pool = nullptr,
+                    const ImageStorage& storage = {}, const RawfileCacheSettings& cache = {});
 
 QString loadComment(const QFileInfo& info);
 
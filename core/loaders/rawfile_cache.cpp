@@ -0,0 +1,461 @@
+//  ***********************************************************************************************
+//
+//  Steca: stress and texture calculator
+//
+//! @file      core/loaders/rawfile_cache.cpp
+//! @brief     Implements functions readRawfileCache, writeRawfileCache, class RawfileSpill
+//!
+//! @homepage  https://github.com/scgmlz/Steca
+//! @license   GNU General Public License v3 or higher (see COPYING)
+//! @copyright Forschungszentrum Jülich GmbH 2016-2018
+//! @authors   Scientific Computing Group at MLZ (see CITATION, MAINTAINER)
+//
+//  ***********************************************************************************************
+
+#include "core/loaders/rawfile_cache.h"
+#include "core/base/cache_dir.h"
+#include "core/base/exception.h"
+#include "core/raw/rawfile.h"
+#include <QStringBuilder> // for ".." % ..
+#include "qcr/base/debug.h" // qWarning
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QSaveFile>
+#include <QTemporaryFile>
+#include <climits>
+#include <cstring>
+
+namespace {
+
+// File layout, written with QDataStream:
+//   magic, source size, source modification time, number of measurements, image w and h,
+//   metadata tag names;
+//   then for each measurement:
+//     number of metadata entries, and for each: tag index, type code, value;
+//     intensity range of the image;
+//     image representation, number of stored pixels, raw pixel arrays;
+//     if the representation has the IMAGE_DEFLATED flag, the pixel arrays are replaced
+//     by their size after qCompress, and the compressed bytes.
+
+const char cacheMagic[8] = {'S','t','e','c','a','R','F','3'};
+
+enum MetaType : qint8 { META_DOUBLE, META_DEG, META_INT, META_UINT, META_STRING };
+enum ImageType : qint8 { IMAGE_DENSE, IMAGE_SPARSE, IMAGE_DEFLATED = 0x10 };
+
+//! Returns the cache file name for the given raw file, or an empty string if there is no cache dir.
+QString cachePath(const QFileInfo& info)
+{
+    return cache_dir::filePath("rawfiles", info.absoluteFilePath().toUtf8());
+}
+
+qint64 modificationTime(const QFileInfo& info)
+{
+    return info.lastModified().toMSecsSinceEpoch();
+}
+
+void writeMetadata(QDataStream& out, const Metadata& md)
+{
+    std::vector<int> present;
+    for (int i=0; i<meta::numAttributes(false); ++i)
+        if (md.has(meta::asciiTag(i)))
+            present.push_back(i);
+    out << qint32(present.size());
+    for (int i : present) {
+        const QVariant v = md.at(meta::asciiTag(i));
+        out << qint32(i);
+        if (v.userType() == qMetaTypeId<deg>())
+            out << qint8(META_DEG) << double(v.value<deg>());
+        else if (v.userType() == QMetaType::Int)
+            out << qint8(META_INT) << qint32(v.toInt());
+        else if (v.userType() == QMetaType::UInt)
+            out << qint8(META_UINT) << quint32(v.toUInt());
+        else if (v.userType() == QMetaType::QString)
+            out << qint8(META_STRING) << v.toString();
+        else
+            out << qint8(META_DOUBLE) << v.toDouble();
+    }
+}
+
+bool readMetadata(QDataStream& in, const QStringList& tags, Metadata& md)
+{
+    qint32 n;
+    in >> n;
+    for (int k=0; k<n && in.status()==QDataStream::Ok; ++k) {
+        qint32 i;
+        qint8 type;
+        in >> i >> type;
+        if (i < 0 || i >= tags.size())
+            return false;
+        const QString& tag = tags.at(i);
+        switch (type) {
+        case META_DOUBLE: { double v; in >> v; md.set(tag, v); break; }
+        case META_DEG:    { double v; in >> v; md.set(tag, deg{v}); break; }
+        case META_INT:    { qint32 v; in >> v; md.set(tag, int(v)); break; }
+        case META_UINT:   { quint32 v; in >> v; md.set(tag, uint(v)); break; }
+        case META_STRING: { QString v; in >> v; md.set(tag, v); break; }
+        default: return false;
+        }
+    }
+    return in.status()==QDataStream::Ok;
+}
+
+template<typename T>
+void writeArray(QDataStream& out, const std::vector<T>& vec)
+{
+    out.writeRawData(reinterpret_cast<const char*>(vec.data()), vec.size() * sizeof(T));
+}
+
+//! Writes one image; deflates its pixel arrays if compressed is set.
+void writeImage(QDataStream& out, const Image& image, bool compressed)
+{
+    const bool sparse = image.isSparse();
+    const qint8 type = sparse ? IMAGE_SPARSE : IMAGE_DENSE;
+    const std::vector<float> dense = sparse ? std::vector<float>() : image.denseIntens();
+    const qint32 n = sparse ? image.sparseIndexes().size() : dense.size();
+    if (!compressed) {
+        out << type << n;
+        if (sparse) {
+            writeArray(out, image.sparseIndexes());
+            writeArray(out, image.sparseIntens());
+        } else {
+            writeArray(out, dense);
+        }
+        return;
+    }
+    QByteArray raw;
+    if (sparse) {
+        raw.append(reinterpret_cast<const char*>(image.sparseIndexes().data()), n * sizeof(int));
+        raw.append(reinterpret_cast<const char*>(image.sparseIntens().data()), n * sizeof(float));
+    } else {
+        raw = QByteArray::fromRawData(reinterpret_cast<const char*>(dense.data()),
+                                      n * sizeof(float));
+    }
+    const QByteArray packed = qCompress(raw, 1);
+    out << qint8(type | IMAGE_DEFLATED) << n << qint32(packed.size());
+    out.writeRawData(packed.constData(), packed.size());
+}
+
+//! Reads numBytes of pixel data into dst; inflates them if deflated is set.
+bool readPixels(QDataStream& in, bool deflated, int numBytes, char* dst)
+{
+    if (!deflated)
+        return in.readRawData(dst, numBytes) == numBytes;
+    qint32 numPacked;
+    in >> numPacked;
+    if (in.status()!=QDataStream::Ok || numPacked<0)
+        return false;
+    QByteArray packed(numPacked, Qt::Uninitialized);
+    if (in.readRawData(packed.data(), numPacked) != numPacked)
+        return false;
+    const QByteArray raw = qUncompress(packed);
+    if (raw.size() != numBytes)
+        return false;
+    std::memcpy(dst, raw.constData(), numBytes);
+    return true;
+}
+
+//! Reads the representation of one image; returns false if it is invalid.
+bool readImageType(QDataStream& in, int count, bool& sparse, bool& deflated, qint32& n)
+{
+    qint8 type;
+    in >> type >> n;
+    if (in.status()!=QDataStream::Ok || n<0 || n>count)
+        return false;
+    deflated = type & IMAGE_DEFLATED;
+    type &= ~IMAGE_DEFLATED;
+    sparse = type==IMAGE_SPARSE;
+    return sparse || (type==IMAGE_DENSE && n==count);
+}
+
+//! Reads one image, as written by writeImage, into intens.
+bool readImage(QDataStream& in, int count, std::vector<float>& intens)
+{
+    bool sparse, deflated;
+    qint32 n;
+    if (!readImageType(in, count, sparse, deflated, n))
+        return false;
+    if (!sparse) {
+        intens.resize(count);
+        return readPixels(
+            in, deflated, count * sizeof(float), reinterpret_cast<char*>(intens.data()));
+    }
+    std::vector<int> indexes(n);
+    std::vector<float> values(n);
+    std::vector<char> raw(n * (sizeof(int) + sizeof(float)));
+    if (!readPixels(in, deflated, raw.size(), raw.data()))
+        return false;
+    std::memcpy(indexes.data(), raw.data(), n * sizeof(int));
+    std::memcpy(values.data(), raw.data() + n * sizeof(int), n * sizeof(float));
+    intens.assign(count, 0);
+    for (int k=0; k<n; ++k) {
+        if (indexes[k]<0 || indexes[k]>=count)
+            return false;
+        intens[indexes[k]] = values[k];
+    }
+    return true;
+}
+
+//! Skips one image, as written by writeImage.
+bool skipImage(QDataStream& in, int count)
+{
+    bool sparse, deflated;
+    qint32 n;
+    if (!readImageType(in, count, sparse, deflated, n))
+        return false;
+    qint32 numBytes = n * (sparse ? sizeof(int) + sizeof(float) : sizeof(float));
+    if (deflated) {
+        in >> numBytes;
+        if (in.status()!=QDataStream::Ok || numBytes<0)
+            return false;
+    }
+    return in.skipRawData(numBytes) == numBytes;
+}
+
+Range intensityRange(double min, double max)
+{
+    return qIsNaN(min) || qIsNaN(max) ? Range() : Range(min, max);
+}
+
+QStringList metadataTags()
+{
+    QStringList tags;
+    for (int i=0; i<meta::numAttributes(false); ++i)
+        tags.append(meta::asciiTag(i));
+    return tags;
+}
+
+void writeMeasurement(QDataStream& out, const Metadata& md, const Image& image, bool compressed)
+{
+    writeMetadata(out, md);
+    out << image.rgeInten().min << image.rgeInten().max;
+    writeImage(out, image, compressed);
+}
+
+//! A cache or spill file, kept open and mapped as long as lazily loaded measurements need it.
+
+class MappedFile {
+public:
+    MappedFile(std::unique_ptr<QFile>&& file)
+        : file_{std::move(file)}
+        , size_{file_->size()}
+        , data_{file_->map(0, size_)}
+    {}
+    ~MappedFile() { if (data_) file_->unmap(data_); }
+
+    bool isMapped() const { return data_; }
+    QFile& file() { return *file_; }
+    QString fileName() const { return file_->fileName(); }
+    bool readImage(qint64 offset, int count, std::vector<float>& intens) const;
+
+private:
+    std::unique_ptr<QFile> file_;
+    const qint64 size_;
+    uchar* const data_;
+};
+
+//! Reads the image at the given offset, as written by writeImage, from the mapped memory.
+bool MappedFile::readImage(qint64 offset, int count, std::vector<float>& intens) const
+{
+    if (offset < 0 || offset >= size_)
+        return false;
+    const int length = qMin(size_ - offset, qint64(INT_MAX));
+    QDataStream in(QByteArray::fromRawData(reinterpret_cast<const char*>(data_) + offset, length));
+    in.setVersion(QDataStream::Qt_5_0);
+    return ::readImage(in, count, intens);
+}
+
+//! Reads all measurements from a cache or spill file into the empty rawfile.
+//! Returns false if the file is invalid, or does not match the raw file.
+
+//! Images are read from the mapped file. If pool is given, they are read only when needed,
+//! and the file stays open and mapped as long as any of the measurements exists.
+
+bool readMeasurements(Rawfile& rawfile, std::unique_ptr<QFile>&& file, ImagePool* pool)
+{
+    const auto mapped = std::make_shared<MappedFile>(std::move(file));
+    if (!mapped->isMapped())
+        return false;
+    QFile& device = mapped->file();
+    if (!device.seek(0))
+        return false;
+    QDataStream in(&device);
+    in.setVersion(QDataStream::Qt_5_0);
+
+    const QFileInfo& info = rawfile.fileInfo();
+    char magic[sizeof(cacheMagic)];
+    qint64 sourceSize, sourceTime;
+    qint32 numMeasurements, w, h;
+    QStringList tags;
+    if (in.readRawData(magic, sizeof(magic)) != sizeof(magic)
+        || memcmp(magic, cacheMagic, sizeof(magic)))
+        return false;
+    in >> sourceSize >> sourceTime >> numMeasurements >> w >> h >> tags;
+    if (in.status()!=QDataStream::Ok || sourceSize!=info.size()
+        || sourceTime!=modificationTime(info) || numMeasurements<=0 || w<=0 || h<=0)
+        return false;
+    const size2d size(w, h);
+    const int count = size.count();
+
+    try {
+        for (int m=0; m<numMeasurements; ++m) {
+            Metadata md;
+            double intenMin, intenMax;
+            if (!readMetadata(in, tags, md))
+                return false;
+            in >> intenMin >> intenMax;
+            const qint64 offset = device.pos();
+            if (!skipImage(in, count))
+                return false;
+            if (pool) {
+                rawfile.addLazyDataset(
+                    std::move(md), size, intensityRange(intenMin, intenMax), pool,
+                    [mapped, offset, size]()->Image{
+                        std::vector<float> intens;
+                        if (!mapped->readImage(offset, size.count(), intens))
+                            THROW("Cannot read image from " % mapped->fileName());
+                        return {size, std::move(intens)}; });
+                continue;
+            }
+            std::vector<float> intens;
+            if (!mapped->readImage(offset, count, intens))
+                return false;
+            rawfile.addDataset(std::move(md), size, std::move(intens));
+        }
+    } catch (const Exception&) {
+        return false;
+    }
+    return in.atEnd();
+}
+
+} // namespace
+
+namespace load {
+
+//! Fills the empty rawfile from its cache file. Returns false if the cache is disabled,
+//! or if there is no valid cache file.
+
+//! The cache file is memory-mapped, so that reading it amounts to copying its pages,
+//! unless the images are compressed.
+//! If pool is given, only the metadata are read; the images are read from the cache file
+//! when first needed, and are held by the pool. The cache file then stays open and mapped,
+//! so that it may be replaced or removed in the meantime.
+
+bool readRawfileCache(Rawfile& rawfile, const RawfileCacheSettings& settings, ImagePool* pool)
+{
+    if (!settings.enabled)
+        return false;
+    const QString path = cachePath(rawfile.fileInfo());
+    if (path.isEmpty() || !QFile::exists(path))
+        return false;
+    cache_dir::markUsed(path);
+    std::unique_ptr<QFile> file(new QFile(path));
+    if (!file->open(QIODevice::ReadOnly))
+        return false;
+    return readMeasurements(rawfile, std::move(file), pool);
+}
+
+//! Writes the cache file for the given rawfile, to be reused as long as the raw file is unchanged;
+//! then removes the least recently used cache files if the budget is exceeded.
+void writeRawfileCache(const Rawfile& rawfile, const RawfileCacheSettings& settings)
+{
+    if (!settings.enabled)
+        return;
+    const QFileInfo& info = rawfile.fileInfo();
+    const QString path = cachePath(info);
+    if (path.isEmpty())
+        return;
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot write raw file cache " << path;
+        return;
+    }
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+    out.writeRawData(cacheMagic, sizeof(cacheMagic));
+    out << qint64(info.size()) << modificationTime(info) << qint32(rawfile.numMeasurements())
+        << qint32(rawfile.imageSize().w) << qint32(rawfile.imageSize().h) << metadataTags();
+    for (const Measurement* m : rawfile.measurements())
+        writeMeasurement(out, m->metadata(), *m->image(), settings.compressed);
+    if (out.status()!=QDataStream::Ok || !file.commit()) {
+        qWarning() << "Cannot write raw file cache " << path;
+        return;
+    }
+    cache_dir::trim("rawfiles", settings.budget);
+}
+
+//  ***********************************************************************************************
+//! @class RawfileSpill
+
+//! The file is created next to the cache files if the cache is enabled, so that it can be
+//! renamed into the cache; otherwise, it is a temporary file that is removed when no longer
+//! needed.
+
+RawfileSpill::RawfileSpill(const QFileInfo& source, const RawfileCacheSettings& settings)
+    : source_{source}
+    , settings_{settings}
+    , cachePath_{settings.enabled ? cachePath(source) : QString()}
+{
+    if (!cachePath_.isEmpty())
+        file_.reset(new QTemporaryFile(QFileInfo(cachePath_).absolutePath() + "/XXXXXX.part"));
+    else
+        file_.reset(new QTemporaryFile(QDir::temp().filePath("steca-images-XXXXXX.bin")));
+    if (!file_->open())
+        THROW("Cannot create a temporary file for the images of " % source.fileName());
+    out_.setDevice(file_.get());
+    out_.setVersion(QDataStream::Qt_5_0);
+    out_.writeRawData(cacheMagic, sizeof(cacheMagic));
+    out_ << qint64(source.size()) << modificationTime(source);
+    countsPos_ = file_->pos();
+    // number of measurements and image size are not known yet; set by finish()
+    out_ << qint32(0) << qint32(0) << qint32(0) << metadataTags();
+}
+
+RawfileSpill::~RawfileSpill() {}
+
+void RawfileSpill::add(Metadata&& md, const size2d& size, std::vector<float>&& intens)
+{
+    writeMeasurement(out_, md, Image(size, std::move(intens)), settings_.compressed);
+    if (out_.status()!=QDataStream::Ok)
+        THROW("Cannot write the images of " % source_.fileName() % " to " % file_->fileName());
+    ++count_;
+    size_ = size;
+}
+
+//! Completes the file, and fills the empty rawfile with lazily loaded measurements from it.
+
+//! If the cache is enabled, the file replaces the cache file of the raw file.
+
+void RawfileSpill::finish(Rawfile& rawfile, ImagePool* pool)
+{
+    ASSERT(count_);
+    if (!file_->seek(countsPos_))
+        THROW("Cannot write to " % file_->fileName());
+    out_ << qint32(count_) << qint32(size_.w) << qint32(size_.h);
+    if (out_.status()!=QDataStream::Ok || !file_->flush())
+        THROW("Cannot write to " % file_->fileName());
+    out_.setDevice(nullptr);
+
+    std::unique_ptr<QFile> file;
+    if (!cachePath_.isEmpty()) {
+        QFile::remove(cachePath_);
+        file_->setAutoRemove(false);
+        if (file_->rename(cachePath_)) {
+            file_.reset();
+            file.reset(new QFile(cachePath_));
+            if (!file->open(QIODevice::ReadOnly))
+                THROW("Cannot open raw file cache " % cachePath_);
+            cache_dir::trim("rawfiles", settings_.budget);
+        } else {
+            qWarning() << "Cannot write raw file cache " << cachePath_;
+            file_->setAutoRemove(true);
+        }
+    }
+    if (!file)
+        file = std::move(file_);
+    const QString fileName = file->fileName();
+    if (!readMeasurements(rawfile, std::move(file), pool))
+        THROW("Cannot read back the images of " % source_.fileName() % " from " % fileName);
+}
+
+} // namespace load
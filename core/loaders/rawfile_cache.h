@@ -0,0 +1,69 @@
+//  ***********************************************************************************************
+//
+//  Steca: stress and texture calculator
+//
+//! @file      core/loaders/rawfile_cache.h
+//! @brief     Declares functions readRawfileCache, writeRawfileCache, class RawfileSpill
+//!
+//! @homepage  https://github.com/scgmlz/Steca
+//! @license   GNU General Public License v3 or higher (see COPYING)
+//! @copyright Forschungszentrum Jülich GmbH 2016-2018
+//! @authors   Scientific Computing Group at MLZ (see CITATION, MAINTAINER)
+//
+//  ***********************************************************************************************
+
+#ifndef RAWFILE_CACHE_H
+#define RAWFILE_CACHE_H
+
+#include "core/raw/rawfile.h"
+#include <QDataStream>
+
+class QTemporaryFile;
+
+//! Binary copies of loaded raw files, kept in the user cache directory.
+
+//! A cache file holds the metadata and images of all measurements of one raw file.
+//! It is only used as long as size and modification time of the raw file are unchanged.
+//! Lazily loaded measurements read their images from the cache file, which stays open and
+//! mapped as long as they exist.
+//! The cache is only used if enabled; when it exceeds its budget, the least recently used
+//! cache files are removed.
+
+namespace load {
+
+//! Settings of the raw file cache, as passed to the loaders.
+struct RawfileCacheSettings {
+    bool enabled {false};
+    bool compressed {false};          //!< deflate the images; smaller files, but slower reading
+    qint64 budget {qint64(32) << 30}; //!< total size of all cache files, in bytes
+};
+
+bool readRawfileCache(Rawfile& rawfile, const RawfileCacheSettings&, ImagePool* pool = nullptr);
+void writeRawfileCache(const Rawfile& rawfile, const RawfileCacheSettings&);
+
+//! Writes the measurements a loader pushes to a file in the layout of the cache files, so that
+//! their images can be read lazily once the loader is done.
+
+class RawfileSpill : public MeasurementSink {
+public:
+    RawfileSpill(const QFileInfo& source, const RawfileCacheSettings&);
+    ~RawfileSpill();
+
+    void add(Metadata&&, const size2d&, std::vector<float>&&) final;
+    void finish(Rawfile& rawfile, ImagePool* pool);
+    int count() const { return count_; }
+
+private:
+    const QFileInfo source_;
+    const RawfileCacheSettings settings_;
+    const QString cachePath_; //!< empty if the cache is not used
+    std::unique_ptr<QTemporaryFile> file_;
+    QDataStream out_;
+    qint64 countsPos_; //!< position of the number of measurements in the header
+    int count_ {0};
+    size2d size_;
+};
+
+} // namespace load
+
+#endif // RAWFILE_CACHE_H
@@ -0,0 +1,150 @@
+//  ***********************************************************************************************
+//
+//  Steca: stress and texture calculator
+//
+//! @file      core/loaders/unpack_pck.cpp
+//! @brief     Implements functions findPck, unpackPck in namespace load
+//!
+//! @homepage  https://github.com/scgmlz/Steca
+//! @license   GNU General Public License v3 or higher (see COPYING)
+//! @copyright Forschungszentrum Jülich GmbH 2016-2018
+//! @authors   Scientific Computing Group at MLZ (see CITATION, MAINTAINER)
+//
+//  ***********************************************************************************************
+
+#include "core/loaders/unpack_pck.h"
+#include "core/base/exception.h"
+#include <QtEndian>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+//! Number of pixels, and bits per pixel, of a block of the packed stream.
+struct PckBlock {
+    int numPixels;
+    int numBits;
+};
+
+//! Block properties for each value of the 6-bit block header.
+struct PckBlockTable {
+    PckBlockTable()
+    {
+        const int numBits[8] = {0, 4, 5, 6, 7, 8, 16, 32};
+        for (int h=0; h<64; ++h)
+            blocks[h] = {1 << (h & 7), numBits[h >> 3]};
+    }
+    PckBlock blocks[64];
+};
+
+const PckBlockTable blockTable;
+
+//! Reads the packed stream, least significant bit first, eight bytes at a time.
+class BitReader {
+public:
+    BitReader(const uchar* data, qint64 length) : pos_{data}, end_{data + length} {}
+    //! Returns the next n bits, 0 < n <= 32.
+    quint32 take(int n)
+    {
+        if (numBits_ < n) {
+            refill();
+            if (numBits_ < n)
+                THROW("truncated pck image");
+        }
+        const quint32 ret = bits_ & ((quint64(1) << n) - 1);
+        bits_ >>= n;
+        numBits_ -= n;
+        return ret;
+    }
+private:
+    void refill()
+    {
+        if (end_ - pos_ >= 8) {
+            bits_ |= qFromLittleEndian<quint64>(pos_) << numBits_;
+            const int numBytes = (63 - numBits_) / 8;
+            pos_ += numBytes;
+            numBits_ += 8 * numBytes;
+            bits_ &= (quint64(1) << numBits_) - 1; // drop the bytes not consumed
+        } else {
+            for (; pos_ < end_ && numBits_ <= 56; ++pos_, numBits_ += 8)
+                bits_ |= quint64(*pos_) << numBits_;
+        }
+    }
+    const uchar* pos_;
+    const uchar* const end_;
+    quint64 bits_ {0};
+    int numBits_ {0};
+};
+
+//! Returns the n-bit two's complement value v as a signed integer.
+inline qint32 signExtend(quint32 v, int n)
+{
+    const qint64 signBit = qint64(1) << (n - 1);
+    return qint32((qint64(v) ^ signBit) - signBit);
+}
+
+} // namespace
+
+namespace load {
+
+//! Finds the header line of a mar345 "pck" packed image, and returns the offset of the
+//! packed stream that follows it, or -1 if there is no such line.
+qint64 findPck(const uchar* data, qint64 length, int& width, int& height)
+{
+    static const char identifier[] = "\nCCP4 packed image, X: ";
+    const char* const begin = reinterpret_cast<const char*>(data);
+    const char* const end = begin + length;
+    const char* pos = std::search(begin, end, identifier, identifier + strlen(identifier));
+    if (pos == end)
+        return -1;
+    const char* const lineEnd = std::find(pos + 1, end, '\n');
+    if (lineEnd == end)
+        return -1;
+    const std::string line(pos, lineEnd + 1);
+    if (sscanf(line.c_str(), "\nCCP4 packed image, X: %04d, Y: %04d\n", &width, &height) != 2)
+        return -1;
+    return lineEnd + 1 - begin;
+}
+
+//! Decodes a packed image of width*height pixels from the stream that follows the header line,
+//! into out. Equivalent to get_pck from 3rdparty/Mar, with 16-bit results read as unsigned.
+
+//! Each block of the stream has a 6-bit header that selects the number of pixels and the
+//! number of bits per pixel from a table. The pixel values are differences to a prediction
+//! from the four neighbours already decoded; these are held in a ring buffer of 16-bit values.
+
+void unpackPck(const uchar* data, qint64 length, int width, int height, float* out)
+{
+    const int total = width * height;
+    int ringSize = 1;
+    while (ringSize < width + 2)
+        ringSize *= 2;
+    const int mask = ringSize - 1;
+    std::vector<qint16> ring(ringSize, 0);
+
+    BitReader reader(data, length);
+    int pixel = 0;
+    while (pixel < total) {
+        const PckBlock& block = blockTable.blocks[reader.take(6)];
+        const int blockEnd = std::min(pixel + block.numPixels, total);
+        for (; pixel < blockEnd; ++pixel) {
+            const qint32 diff = block.numBits ? signExtend(reader.take(block.numBits), block.numBits)
+                                              : 0;
+            qint16 v;
+            if (pixel > width)
+                v = qint16(diff + (ring[(pixel - 1) & mask] + ring[(pixel - width + 1) & mask]
+                                   + ring[(pixel - width) & mask]
+                                   + ring[(pixel - width - 1) & mask] + 2) / 4);
+            else if (pixel != 0)
+                v = qint16(ring[(pixel - 1) & mask] + diff);
+            else
+                v = qint16(diff);
+            ring[pixel & mask] = v;
+            out[pixel] = quint16(v);
+        }
+    }
+}
+
+} // namespace load
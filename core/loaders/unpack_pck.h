@@ -0,0 +1,27 @@
+//  ***********************************************************************************************
+//
+//  Steca: stress and texture calculator
+//
+//! @file      core/loaders/unpack_pck.h
+//! @brief     Declares functions findPck, unpackPck in namespace load
+//!
+//! @homepage  https://github.com/scgmlz/Steca
+//! @license   GNU General Public License v3 or higher (see COPYING)
+//! @copyright Forschungszentrum Jülich GmbH 2016-2018
+//! @authors   Scientific Computing Group at MLZ (see CITATION, MAINTAINER)
+//
+//  ***********************************************************************************************
+
+#ifndef UNPACK_PCK_H
+#define UNPACK_PCK_H
+
+#include <QtGlobal>
+
+namespace load {
+
+qint64 findPck(const uchar* data, qint64 length, int& width, int& height);
+void unpackPck(const uchar* data, qint64 length, int width, int height, float* out);
+
+} // namespace load
+
+#endif // UNPACK_PCK_H
@@ -0,0 +1,82 @@
+//  ***********************************************************************************************
+//
+//  Steca: stress and texture calculator
+//
+//! @file      core/raw/compressed_frame.cpp
+//! @brief     Implements class CompressedFrame
+//!
+//! @homepage  https://github.com/scgmlz/Steca
+//! @license   GNU General Public License v3 or higher (see COPYING)
+//! @copyright Forschungszentrum Jülich GmbH 2016-2018
+//! @authors   Scientific Computing Group at MLZ (see CITATION, MAINTAINER)
+//
+//  ***********************************************************************************************
+
+#include "core/raw/compressed_frame.h"
+#include "core/base/exception.h"
+#include "qcr/base/debug.h" // ASSERT
+#include <cmath>
+
+namespace {
+
+template<typename T>
+void narrow(const std::vector<float>& intens, QByteArray& raw)
+{
+    T* out = reinterpret_cast<T*>(raw.data());
+    for (int i=0; i<intens.size(); ++i)
+        out[i] = T(intens[i]);
+}
+
+template<typename T>
+void widen(const QByteArray& raw, std::vector<float>& intens)
+{
+    const T* in = reinterpret_cast<const T*>(raw.constData());
+    for (int i=0; i<intens.size(); ++i)
+        intens[i] = in[i];
+}
+
+} // namespace
+
+//! Returns true if all intensities are integer counts that fit into 32 bits.
+bool CompressedFrame::canHold(const std::vector<float>& intens)
+{
+    if (intens.empty())
+        return false;
+    for (const float val : intens)
+        if (!(val >= 0 && val < 4294967296.f && val == std::floor(val)))
+            return false; // also catches NaN
+    return true;
+}
+
+CompressedFrame::CompressedFrame(const size2d& size, const std::vector<float>& intens)
+    : size_{size}
+{
+    ASSERT(intens.size() == size.count());
+    ASSERT(canHold(intens));
+    const auto minmax = std::minmax_element(intens.begin(), intens.end());
+    rgeInten_.set(*minmax.first, *minmax.second);
+    bytesPerPixel_ = *minmax.second < 65536 ? 2 : 4;
+    QByteArray raw(intens.size() * bytesPerPixel_, Qt::Uninitialized);
+    if (bytesPerPixel_ == 2)
+        narrow<quint16>(intens, raw);
+    else
+        narrow<quint32>(intens, raw);
+    data_ = qCompress(raw, 1); // fast; counts compress well even so
+    deflated_ = data_.size() < raw.size();
+    if (!deflated_)
+        data_ = raw;
+    data_.squeeze(); // qCompress reserves room for the worst case
+}
+
+Image CompressedFrame::decode() const
+{
+    const QByteArray raw = deflated_ ? qUncompress(data_) : data_;
+    std::vector<float> intens(size_.count());
+    if (raw.size() != intens.size() * bytesPerPixel_)
+        THROW("Corrupt compressed image");
+    if (bytesPerPixel_ == 2)
+        widen<quint16>(raw, intens);
+    else
+        widen<quint32>(raw, intens);
+    return {size_, std::move(intens)};
+}
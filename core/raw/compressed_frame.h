@@ -0,0 +1,46 @@
+//  ***********************************************************************************************
+//
+//  Steca: stress and texture calculator
+//
+//! @file      core/raw/compressed_frame.h
+//! @brief     Defines class CompressedFrame
+//!
+//! @homepage  https://github.com/scgmlz/Steca
+//! @license   GNU General Public License v3 or higher (see COPYING)
+//! @copyright Forschungszentrum Jülich GmbH 2016-2018
+//! @authors   Scientific Computing Group at MLZ (see CITATION, MAINTAINER)
+//
+//  ***********************************************************************************************
+
+#ifndef COMPRESSED_FRAME_H
+#define COMPRESSED_FRAME_H
+
+#include "core/raw/image.h"
+#include <QByteArray>
+
+//! Lossless compact copy of an image whose pixels are integer counts.
+
+//! The counts are narrowed to 16 or 32 bits, depending on their maximum, and then deflated.
+//! If deflation does not pay off, the narrowed counts are kept as they are.
+
+class CompressedFrame {
+public:
+    CompressedFrame() = delete;
+    CompressedFrame(const size2d& size, const std::vector<float>& intens);
+    CompressedFrame(const CompressedFrame&) = delete;
+
+    static bool canHold(const std::vector<float>& intens);
+
+    Image decode() const;
+    const Range& rgeInten() const { return rgeInten_; }
+    size_t memSize() const { return sizeof(*this) + data_.capacity(); }
+
+private:
+    size2d size_;
+    Range rgeInten_;
+    int bytesPerPixel_; //!< 2 or 4
+    bool deflated_;
+    QByteArray data_;
+};
+
+#endif // COMPRESSED_FRAME_H
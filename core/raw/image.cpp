@@ -14,37 +14,110 @@
 
 #include "core/raw/image.h"
 #include "core/base/exception.h"
+#include "core/raw/pixel_store.h"
 #include "qcr/base/debug.h"
 
 Image::Image(const size2d& size, float val)
     : size_{size}
     , intens_ (size.count(), val)
     , rangeInten_{val, val}
-{}
+{
+    pixels_ = intens_.data();
+}
+
+const double Image::maxSparseDensity = 0.1;
+
+//! Takes the intensities of all pixels; stores them sparsely if few are nonzero.
 
-Image::Image(const size2d& size, std::vector<float>&& intens)
+//! Otherwise, if a store is given, the pixels are copied there, and intens is freed.
+
+Image::Image(const size2d& size, std::vector<float>&& intens,
+             const std::shared_ptr<PixelStore>& store)
     : size_{size}
-    , intens_ {std::move(intens)}
 {
-    ASSERT(intens_.size() == size.count());
-    rangeInten_.set(intens_[0], intens_[0]);
-    for (const auto val: intens_)
+    ASSERT(intens.size() == size.count());
+    const int n = intens.size();
+    const int numNonzero = n - std::count(intens.begin(), intens.end(), 0.f);
+    if (n && numNonzero <= maxSparseDensity * n) {
+        sparse_ = true;
+        sparseIndexes_.reserve(numNonzero);
+        sparseIntens_.reserve(numNonzero);
+        for (int i=0; i<n; ++i) {
+            if (intens[i] != 0.f) {
+                sparseIndexes_.push_back(i);
+                sparseIntens_.push_back(intens[i]);
+            }
+        }
+        if (numNonzero < n)
+            rangeInten_.set(0, 0);
+        else
+            rangeInten_.set(sparseIntens_[0], sparseIntens_[0]);
+        for (const auto val: sparseIntens_)
+            rangeInten_.extendBy(val);
+        return;
+    }
+    rangeInten_.set(intens[0], intens[0]);
+    for (const auto val: intens)
         rangeInten_.extendBy(val);
+    if (store) {
+        float* pixels = store->allocate(n);
+        std::copy(intens.begin(), intens.end(), pixels);
+        pixels_ = pixels;
+        store_ = store;
+        std::vector<float>().swap(intens);
+        return;
+    }
+    intens_ = std::move(intens);
+    pixels_ = intens_.data();
+}
+
+std::vector<float> Image::denseIntens() const
+{
+    if (!sparse_)
+        return std::vector<float>(pixels_, pixels_ + size_.count());
+    std::vector<float> ret(size_.count(), 0.f);
+    for (int k=0; k<sparseIndexes_.size(); ++k)
+        ret[sparseIndexes_[k]] = sparseIntens_[k];
+    return ret;
+}
+
+size_t Image::memSize() const
+{
+    return sizeof(*this) + intens_.capacity() * sizeof(float)
+        + sparseIndexes_.capacity() * sizeof(int) + sparseIntens_.capacity() * sizeof(float);
+}
+
+void Image::makeDense()
+{
+    intens_ = denseIntens();
+    pixels_ = intens_.data();
+    store_.reset();
+    sparse_ = false;
+    sparseIndexes_.clear();
+    sparseIntens_.clear();
 }
 
 void Image::clear()
 {
     size_ = size2d(0, 0);
     intens_.clear();
+    pixels_ = nullptr;
+    store_.reset();
+    sparse_ = false;
+    sparseIndexes_.clear();
+    sparseIntens_.clear();
     rangeInten_.invalidate();
 }
 
 void Image::fill(float val, const size2d& size)
 {
+    if (sparse_ || store_)
+        makeDense();
     int oldSize = intens_.size();
     int newSize = size.count();
     size_ = size;
     intens_.resize(newSize, val); // sets only new pixels to val
+    pixels_ = intens_.data();
     for (int i=0; i<qMin(oldSize, newSize); ++i) // set all remaining pixels to val
         intens_[i] = val;
     rangeInten_.set(val, val); // set Range to val
@@ -53,7 +126,14 @@ void Image::fill(float val, const size2d& size)
 void Image::addImage(const Image& that)
 {
     ASSERT(size() == that.size());
+    if (sparse_ || store_)
+        makeDense();
     rangeInten_.extendBy(that.rgeInten());
+    if (that.sparse_) {
+        for (int k=0; k<that.sparseIndexes_.size(); ++k)
+            intens_[that.sparseIndexes_[k]] += that.sparseIntens_[k];
+        return;
+    }
     for (int i=0; i<intens_.size(); ++i)
-        intens_[i] += that.intens_[i];
+        intens_[i] += that.pixels_[i];
 }
@@ -17,35 +17,67 @@
 
 #include "core/typ/range.h"
 #include "core/typ/size2d.h"
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+class PixelStore;
 
 //! Holds a detector image, and provides read and write access
+
+//! Images with few nonzero pixels are stored sparsely, as sorted lists of the indices
+//! and intensities of nonzero pixels. Per-pixel access works for both representations,
+//! but takes a binary search for sparse images; bulk operations should check isSparse(),
+//! or work on denseIntens().
+//! Dense pixels are either on the heap, or in a PixelStore given at construction.
+
 class Image {
 public:
     Image() {} // empty image
     Image(const size2d&, float val);
-    Image(const size2d& size, std::vector<float>&& intens);
+    Image(const size2d& size, std::vector<float>&& intens,
+          const std::shared_ptr<PixelStore>& store = {});
     Image(const Image&) = delete;
     Image(Image&&) = default;
     Image& operator=(Image&&) = default;
 
     void clear();
     void fill(float val, const size2d& size);
-    void setInten1d(int i, float val) { intens_[i] = val; }
+    void setInten1d(int i, float val) { if (sparse_ || store_) makeDense(); intens_[i] = val; }
     void setInten2d(int ix, int iy, float val) { setInten1d(pointToIndex(ix, iy), val); }
     void addImage(const Image&); //!< add pointwise
 
-    bool isEmpty() const { return intens_.empty(); }
+    bool isEmpty() const { return !sparse_ && !store_ && intens_.empty(); }
     const size2d& size() const { return size_; }
-    float inten1d(int i) const { return intens_[i]; }
+    float inten1d(int i) const { return sparse_ ? sparseInten1d(i) : pixels_[i]; }
     float inten2d(int ix, int iy) const { return inten1d(pointToIndex(ix, iy)); }
     const Range& rgeInten() const { return rangeInten_; }
 
+    bool isSparse() const { return sparse_; }
+    const std::vector<int>& sparseIndexes() const { return sparseIndexes_; } //!< ascending
+    const std::vector<float>& sparseIntens() const { return sparseIntens_; }
+    std::vector<float> denseIntens() const; //!< intensities of all pixels
+    size_t memSize() const; //!< approximate heap footprint in bytes
+
+    static const double maxSparseDensity; //!< fraction of nonzero pixels up to which to be sparse
+
 private:
     size2d size_;
-    std::vector<float> intens_;
+    std::vector<float> intens_; //!< all pixels, if neither sparse_ nor in store_
+    const float* pixels_ {nullptr}; //!< all pixels, if not sparse_: intens_.data() or in store_
+    std::shared_ptr<PixelStore> store_; //!< keeps the pixels alive, if they are there
+    bool sparse_ {false};
+    std::vector<int> sparseIndexes_; //!< nonzero pixels, if sparse_
+    std::vector<float> sparseIntens_;
     Range rangeInten_; // TODO: update Intensity Range when single pixel gets changed
 
     int pointToIndex(int ix, int iy) const { return iy * size_.w + ix; }
+    float sparseInten1d(int i) const {
+        auto it = std::lower_bound(sparseIndexes_.begin(), sparseIndexes_.end(), i);
+        return it != sparseIndexes_.end() && *it == i
+            ? sparseIntens_[it - sparseIndexes_.begin()] : 0.f;
+    }
+    void makeDense();
 };
 
 #endif // IMAGE_H
@@ -0,0 +1,138 @@
+//  ***********************************************************************************************
+//
+//  Steca: stress and texture calculator
+//
+//! @file      core/raw/image_pool.cpp
+//! @brief     Implements class ImagePool
+//!
+//! @homepage  https://github.com/scgmlz/Steca
+//! @license   GNU General Public License v3 or higher (see COPYING)
+//! @copyright Forschungszentrum Jülich GmbH 2016-2018
+//! @authors   Scientific Computing Group at MLZ (see CITATION, MAINTAINER)
+//
+//  ***********************************************************************************************
+
+#include "core/raw/image_pool.h"
+#include "qcr/base/debug.h" // ASSERT
+
+//  ***********************************************************************************************
+//! @class ImagePool
+
+//! Returns the image referenced by slot; if it has been released, reloads it by calling load.
+
+//! Loading is done without holding the lock, so that several images can be loaded concurrently.
+
+std::shared_ptr<const Image> ImagePool::get(ImageSlot& slot, const std::function<Image()>& load)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (std::shared_ptr<const Image> ret = slot.image_.lock()) {
+            touch(slot, ret);
+            return ret;
+        }
+    }
+    std::shared_ptr<const Image> loaded = std::make_shared<const Image>(load());
+    std::lock_guard<std::mutex> lock(mutex_);
+    // another thread may have loaded the image meanwhile
+    if (std::shared_ptr<const Image> ret = slot.image_.lock()) {
+        touch(slot, ret);
+        return ret;
+    }
+    slot.image_ = loaded;
+    touch(slot, loaded);
+    return loaded;
+}
+
+//! Releases all images. Those still in use remain valid until their users drop them.
+void ImagePool::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (Entry& entry : resident_)
+        entry.slot->pool_ = nullptr;
+    resident_.clear();
+    memSize_ = 0;
+}
+
+void ImagePool::setBudget(size_t budget)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    budget_ = budget;
+    trim();
+}
+
+size_t ImagePool::memSize() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return memSize_;
+}
+
+int ImagePool::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return resident_.size();
+}
+
+//! Makes image the most recently used one, adding it to the pool if necessary. Needs the lock.
+void ImagePool::touch(ImageSlot& slot, const std::shared_ptr<const Image>& image)
+{
+    if (slot.pool_) {
+        ASSERT(slot.pool_ == this);
+        resident_.splice(resident_.end(), resident_, slot.pos_); // move to back
+        return;
+    }
+    slot.pos_ = resident_.insert(resident_.end(), Entry{image, &slot});
+    slot.pool_ = this;
+    memSize_ += image->memSize();
+    trim();
+}
+
+//! Releases least recently used images until the budget is met; keeps the newest one.
+//! Needs the lock.
+void ImagePool::trim()
+{
+    while (resident_.size() > 1 && memSize_ > budget_) {
+        Entry& oldest = resident_.front();
+        memSize_ -= oldest.image->memSize();
+        oldest.slot->pool_ = nullptr;
+        resident_.pop_front();
+    }
+}
+
+//! Releases the image of a slot that is going away.
+void ImagePool::forget(ImageSlot& slot)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (slot.pool_ != this) // released meanwhile
+        return;
+    memSize_ -= slot.pos_->image->memSize();
+    resident_.erase(slot.pos_);
+    slot.pool_ = nullptr;
+}
+
+//! Transfers residence from one slot to another, as the Measurement holding it is moved.
+void ImagePool::relocate(ImageSlot& from, ImageSlot& to)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (from.pool_ != this) // released meanwhile
+        return;
+    from.pos_->slot = &to;
+    to.pos_ = from.pos_;
+    to.pool_ = this;
+    from.pool_ = nullptr;
+}
+
+//  ***********************************************************************************************
+//! @class ImageSlot
+
+ImageSlot::ImageSlot(ImageSlot&& other)
+    : image_{std::move(other.image_)}
+{
+    if (ImagePool* pool = other.pool_)
+        pool->relocate(other, *this);
+}
+
+ImageSlot::~ImageSlot()
+{
+    if (ImagePool* pool = pool_)
+        pool->forget(*this);
+}
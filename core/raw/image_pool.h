@@ -0,0 +1,86 @@
+//  ***********************************************************************************************
+//
+//  Steca: stress and texture calculator
+//
+//! @file      core/raw/image_pool.h
+//! @brief     Defines class ImagePool
+//!
+//! @homepage  https://github.com/scgmlz/Steca
+//! @license   GNU General Public License v3 or higher (see COPYING)
+//! @copyright Forschungszentrum Jülich GmbH 2016-2018
+//! @authors   Scientific Computing Group at MLZ (see CITATION, MAINTAINER)
+//
+//  ***********************************************************************************************
+
+#ifndef IMAGE_POOL_H
+#define IMAGE_POOL_H
+
+#include "core/raw/image.h"
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+
+class ImageSlot;
+
+//! Resident images of lazily loaded `Measurement`s; least recently used ones are released.
+
+//! Each lazy Measurement holds an ImageSlot with a weak pointer to its image, and with the
+//! image's position in the pool, which holds the strong pointers. Whenever the total footprint
+//! exceeds the memory budget, the pool releases images, starting with the least recently used
+//! one. An image stays alive as long as a caller holds the shared pointer obtained from get(),
+//! and is reloaded on the next get() after being released.
+//! Thread safe; get() takes constant time, apart from loading.
+
+class ImagePool {
+public:
+    ImagePool() = delete;
+    ImagePool(size_t budget) : budget_{budget} {}
+    ImagePool(const ImagePool&) = delete;
+    ~ImagePool() { clear(); }
+
+    std::shared_ptr<const Image> get(ImageSlot& slot, const std::function<Image()>& load);
+    void clear();
+    void setBudget(size_t budget);
+
+    size_t budget() const { return budget_; }
+    size_t memSize() const;
+    int size() const;
+
+private:
+    friend class ImageSlot;
+    struct Entry {
+        std::shared_ptr<const Image> image;
+        ImageSlot* slot;
+    };
+
+    void touch(ImageSlot& slot, const std::shared_ptr<const Image>& image);
+    void trim();
+    void forget(ImageSlot& slot);
+    void relocate(ImageSlot& from, ImageSlot& to);
+
+    size_t budget_;
+    size_t memSize_ {0};
+    std::list<Entry> resident_; //!< MRU last
+    mutable std::mutex mutex_;
+};
+
+//! Handle of one lazily loaded image, to be held by its Measurement.
+
+class ImageSlot {
+public:
+    ImageSlot() = default;
+    ImageSlot(const ImageSlot&) = delete;
+    ImageSlot(ImageSlot&& other);
+    ~ImageSlot();
+
+    bool expired() const { return image_.expired(); } //!< true if the image must be reloaded
+
+private:
+    friend class ImagePool;
+    std::weak_ptr<const Image> image_;
+    ImagePool* pool_ {nullptr}; //!< set while the image is resident in pool_
+    std::list<ImagePool::Entry>::iterator pos_; //!< position in pool_, if set
+};
+
+#endif // IMAGE_POOL_H
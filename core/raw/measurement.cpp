@@ -16,14 +16,55 @@
 //#include "qcr/base/debug.h"
 
 Measurement::Measurement(
-    const int position, Metadata&& md, const size2d& size, std::vector<float>&& intens)
+    const int position, Metadata&& md, const size2d& size, std::vector<float>&& intens,
+    const std::shared_ptr<PixelStore>& store)
     : position_{position}
     , metadata_ {std::move(md)}
-    , image_ {new Image{size, std::move(intens)}}
+    , image_ {std::make_shared<const Image>(size, std::move(intens), store)}
+{
+    size_ = image_->size();
+    rgeInten_ = image_->rgeInten();
+}
+
+//! Constructs a lazy Measurement, whose image will be read by loadImage when first needed.
+Measurement::Measurement(
+    const int position, Metadata&& md, const size2d& size, const Range& rgeInten,
+    ImagePool* pool, std::function<Image()>&& loadImage)
+    : position_{position}
+    , metadata_ {std::move(md)}
+    , size_ {size}
+    , rgeInten_ {rgeInten}
+    , pool_ {pool}
+    , loadImage_ {std::move(loadImage)}
 {}
 
-Range Measurement::rgeInten() const { return image_->rgeInten(); }
-size2d Measurement::imageSize() const { return image_->size(); }
+std::shared_ptr<const Image> Measurement::image() const
+{
+    if (!pool_)
+        return image_;
+    return pool_->get(lazyImage_, loadImage_);
+}
+
+//! Returns image times normalizer, where invalid pixels are NaN.
+
+//! The result is cached until called with another normalizer generation.
+//! Not thread safe: call from one thread, then share the result.
+
+const Image& Measurement::correctedImage(const Image& normalizer, int generation) const
+{
+    if (corrected_ && correctedGeneration_ == generation)
+        return *corrected_;
+    const int n = size_.count();
+    std::vector<float> intens = image()->denseIntens();
+    for (int i=0; i<n; ++i)
+        intens[i] *= normalizer.inten1d(i);
+    corrected_.reset(new Image{size_, std::move(intens)});
+    correctedGeneration_ = generation;
+    return *corrected_;
+}
+
+Range Measurement::rgeInten() const { return rgeInten_; }
+size2d Measurement::imageSize() const { return size_; }
 
 double Measurement::monitorCount() const { return metadata_.get<double>("mon"); }
 double Measurement::deltaMonitorCount() const { return metadata_.get<double>("delta_mon"); }
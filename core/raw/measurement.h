@@ -15,19 +15,26 @@
 #ifndef MEASUREMENT_H
 #define MEASUREMENT_H
 
-#include "core/raw/image.h"
+#include "core/raw/image_pool.h"
 #include "core/raw/metadata.h"
+#include <functional>
 #include <memory>
 
 //! A Measurement consts of an Image with associated Metadata
 
+//! The image is either held in memory from the start, or it is loaded lazily: then only its size
+//! and intensity range are known beforehand, and the pixels are read on demand through an ImagePool.
+
 class Measurement {
 
 public:
     Measurement() = delete;
     Measurement(const Measurement&) = delete;
     Measurement(Measurement&&) = default;
-    Measurement(const int position, Metadata&&, const size2d&, std::vector<float>&&);
+    Measurement(const int position, Metadata&&, const size2d&, std::vector<float>&&,
+                const std::shared_ptr<PixelStore>& store = {});
+    Measurement(const int position, Metadata&&, const size2d&, const Range& rgeInten,
+                ImagePool* pool, std::function<Image()>&& loadImage);
 
     int position() const { return position_; }
     const Metadata& metadata() const { return metadata_; }
@@ -44,7 +51,9 @@ public:
 
     Range rgeInten() const;
 
-    const Image& image() const { return *image_; }
+    std::shared_ptr<const Image> image() const; //!< hold the result while using the image
+    const Image& correctedImage(const Image& normalizer, int generation) const;
+    void releaseCorrectedImage() const { corrected_.reset(); }
     size2d imageSize() const;
     void setMeasurementNum(int i) { metadata_.set("numMeasurement", i); }
     void setMeasurementTime(double t) { metadata_.set("measure_t", t); }
@@ -52,7 +61,14 @@ public:
 private:
     const int position_; //! position in file_
     Metadata metadata_;
-    std::unique_ptr<Image> image_; // TODO consider without pointer
+    size2d size_;
+    Range rgeInten_;
+    std::shared_ptr<const Image> image_; //!< unless lazy
+    ImagePool* pool_ {nullptr};         //!< if lazy, holds the resident image
+    std::function<Image()> loadImage_;  //!< if lazy, reads the image
+    mutable ImageSlot lazyImage_;       //!< if lazy, refers to the resident image
+    mutable std::unique_ptr<Image> corrected_; //!< image times normalizer
+    mutable int correctedGeneration_ {-1}; //!< normalizer generation corrected_ was made with
 };
 
 #endif // MEASUREMENT_H
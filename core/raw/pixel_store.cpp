@@ -0,0 +1,50 @@
+//  ***********************************************************************************************
+//
+//  Steca: stress and texture calculator
+//
+//! @file      core/raw/pixel_store.cpp
+//! @brief     Implements class ScratchFileStore
+//!
+//! @homepage  https://github.com/scgmlz/Steca
+//! @license   GNU General Public License v3 or higher (see COPYING)
+//! @copyright Forschungszentrum Jülich GmbH 2016-2018
+//! @authors   Scientific Computing Group at MLZ (see CITATION, MAINTAINER)
+//
+//  ***********************************************************************************************
+
+#include "core/raw/pixel_store.h"
+#include "core/base/exception.h"
+#include <QDir>
+#include <QStringBuilder> // for ".." % ..
+
+//! Creates an empty store; scratch files are created in the system temporary directory
+//! (set TMPDIR to change it) as needed.
+ScratchFileStore::ScratchFileStore(qint64 segmentSize)
+    : segmentSize_{segmentSize}
+{}
+
+float* ScratchFileStore::allocate(int n)
+{
+    const qint64 numBytes = qint64(n) * sizeof(float);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (numBytes > numFree_) {
+        // start a new segment; the unused rest of the last one is lost
+        const qint64 size = qMax(segmentSize_, numBytes);
+        std::unique_ptr<QTemporaryFile> file(
+            new QTemporaryFile(QDir::temp().filePath("steca-pixels-XXXXXX.bin")));
+        if (!file->open())
+            THROW("Cannot create scratch file " % file->fileTemplate());
+        if (!file->resize(size))
+            THROW("Cannot enlarge scratch file " % file->fileName());
+        free_ = file->map(0, size);
+        if (!free_)
+            THROW("Cannot map scratch file " % file->fileName());
+        files_.push_back(std::move(file));
+        fileSize_ += size;
+        numFree_ = size;
+    }
+    float* ret = reinterpret_cast<float*>(free_);
+    free_ += numBytes;
+    numFree_ -= numBytes;
+    return ret;
+}
@@ -0,0 +1,58 @@
+//  ***********************************************************************************************
+//
+//  Steca: stress and texture calculator
+//
+//! @file      core/raw/pixel_store.h
+//! @brief     Defines classes PixelStore, ScratchFileStore
+//!
+//! @homepage  https://github.com/scgmlz/Steca
+//! @license   GNU General Public License v3 or higher (see COPYING)
+//! @copyright Forschungszentrum Jülich GmbH 2016-2018
+//! @authors   Scientific Computing Group at MLZ (see CITATION, MAINTAINER)
+//
+//  ***********************************************************************************************
+
+#ifndef PIXEL_STORE_H
+#define PIXEL_STORE_H
+
+#include <QTemporaryFile>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//! Storage for the pixels of dense images, as alternative to the heap.
+
+//! Images placed in a store hold a shared pointer to it, so that it lives as long as they do.
+//! Memory is never given back to the store; it is freed when the store is destroyed.
+
+class PixelStore {
+public:
+    virtual ~PixelStore() {}
+    //! Returns room for n floats; must be thread safe.
+    virtual float* allocate(int n) = 0;
+};
+
+//! Stores pixels in memory-mapped temporary files, so that the OS can page them out.
+
+//! Storage grows by segments, each of which is a file of its own, sized before it is mapped;
+//! files are never resized while mapped, which some systems do not allow. Images never
+//! straddle segment boundaries; an image larger than the segment size gets a segment of its own.
+
+class ScratchFileStore : public PixelStore {
+public:
+    ScratchFileStore(qint64 segmentSize = qint64(1) << 30);
+    ScratchFileStore(const ScratchFileStore&) = delete;
+
+    float* allocate(int n) final;
+    qint64 fileSize() const { return fileSize_; } //!< total size of all segment files
+
+private:
+    const qint64 segmentSize_;
+    std::vector<std::unique_ptr<QTemporaryFile>> files_; //!< one per segment
+    qint64 fileSize_ {0};
+    uchar* free_ {nullptr}; //!< first unused byte in the last segment
+    qint64 numFree_ {0};    //!< number of unused bytes in the last segment
+    std::mutex mutex_;
+};
+
+#endif // PIXEL_STORE_H
@@ -14,21 +14,47 @@
 
 #include "core/base/exception.h"
 #include "core/raw/rawfile.h"
+#include "core/raw/compressed_frame.h"
 #include "qcr/base/debug.h"
 #include <QStringBuilder> // for ".." % ..
 
-Rawfile::Rawfile(const QString& fileName)
+Rawfile::Rawfile(const QString& fileName, const ImageStorage& storage)
     : fileInfo_{fileName}
+    , storage_{storage}
 {}
 
 //! The loaders use this function to push cluster
 void Rawfile::addDataset(Metadata&& md, const size2d& sz, std::vector<float>&& ivec)
+{
+    if (imageSize_.isEmpty())
+        imageSize_ = sz;
+    else if (sz != imageSize_)
+        THROW("Inconsistent image size in " % fileName());
+    if (storage_.sink) {
+        storage_.sink->add(std::move(md), sz, std::move(ivec));
+        return;
+    }
+    if (storage_.framePool && CompressedFrame::canHold(ivec)) {
+        const auto frame = std::make_shared<const CompressedFrame>(sz, ivec);
+        measurements_.emplace_back(
+            (int)measurements_.size(), std::move(md), sz, frame->rgeInten(), storage_.framePool,
+            [frame]()->Image{ return frame->decode(); });
+        return;
+    }
+    measurements_.emplace_back(
+        (int)measurements_.size(), std::move(md), sz, std::move(ivec), storage_.store);
+}
+
+//! The raw file cache uses this function to push cluster whose images are read on demand
+void Rawfile::addLazyDataset(Metadata&& md, const size2d& sz, const Range& rgeInten,
+                             ImagePool* pool, std::function<Image()>&& loadImage)
 {
     if (!measurements_.size())
         imageSize_ = sz;
     else if (sz != imageSize_)
         THROW("Inconsistent image size in " % fileName());
-    measurements_.push_back({(int)measurements_.size(), std::move(md), sz, std::move(ivec)});
+    measurements_.emplace_back(
+        (int)measurements_.size(), std::move(md), sz, rgeInten, pool, std::move(loadImage));
 }
 
 std::vector<const Measurement*> const Rawfile::measurements() const
@@ -45,6 +71,6 @@ Image Rawfile::summedImage() const
     // TODO start from the first given image, not from a zero image
     Image ret(measurements_.front().imageSize(), 0.);
     for (const Measurement& one : measurements_)
-        ret.addImage(one.image());
+        ret.addImage(*one.image());
     return ret;
 }
@@ -16,17 +16,38 @@
 #define RAWFILE_H
 
 #include "core/raw/measurement.h"
+#include "core/raw/pixel_store.h"
 #include <QFileInfo>
 
+//! Receives the measurements a loader pushes, instead of the Rawfile.
+
+class MeasurementSink {
+public:
+    virtual ~MeasurementSink() {}
+    virtual void add(Metadata&&, const size2d&, std::vector<float>&&) = 0;
+};
+
+//! Where and in which form a Rawfile keeps the images it is given; by default, on the heap.
+
+struct ImageStorage {
+    std::shared_ptr<PixelStore> store; //!< if set, holds the pixels of dense images
+    //! If set, images of integer counts are kept compressed, and decoded into this pool.
+    ImagePool* framePool {nullptr};
+    //! If set, measurements are handed on to it, and not kept by the Rawfile.
+    MeasurementSink* sink {nullptr};
+};
+
 //! A file (loaded from a disk file) that contains a data sequence.
 class Rawfile final {
 public:
-    Rawfile(const QString& fileName);
+    Rawfile(const QString& fileName, const ImageStorage& storage = {});
     Rawfile(const Rawfile&) = delete;
     Rawfile(Rawfile&&) = default; // needed by loaders
     Rawfile& operator=(Rawfile&&) = default;
 
     void addDataset(Metadata&&, const size2d&, std::vector<float> &&);
+    void addLazyDataset(Metadata&&, const size2d&, const Range& rgeInten,
+                        ImagePool*, std::function<Image()>&& loadImage);
     void setMeasurementNum(int i, int j) { measurements_.at(i).setMeasurementNum(j); }
     void setMeasurementTime(int i, double t) { measurements_.at(i).setMeasurementTime(t); }
 
@@ -43,6 +64,7 @@ private:
     QFileInfo fileInfo_;
     std::vector<Measurement> measurements_;
     size2d imageSize_;
+    ImageStorage storage_; //!< where to put the images of new measurements
 };
 
 #endif // RAWFILE_H
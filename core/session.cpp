@@ -33,16 +33,27 @@ void Session::onDetector() const
 {
     gSession->gammaSelection.onData();
     gSession->thetaSelection.onData();
-    angleMap.invalidate();
-    activeClusters.avgDfgram.invalidate();
+    activeClusters.invalidateAvg();
+    memberHistograms.clear();
     for (auto const& cluster: dataset.allClusters)
-        cluster->dfgrams.clear_vector();
+        cluster->invalidateDfgrams();
 }
 
+//! Discards all projections, since the 2theta bins move with the cut. The AngleMaps for
+//! the new cut are derived from those for the old one, see AngleMap::deriveFrom.
 void Session::onCut() const
 {
     onDetector();
-    corrset.invalidateNormalizer();
+    if (corrset.hasFile()) // otherwise, the normalizer does not depend on the cut
+        corrset.invalidateNormalizer();
+}
+
+void Session::onGammaSelection() const
+{
+    gSession->gammaSelection.onData();
+    activeClusters.invalidateAvg();
+    for (auto const& cluster: dataset.allClusters)
+        cluster->invalidateSlices();
 }
 
 void Session::onBaseline() const
@@ -64,20 +75,31 @@ void Session::onInterpol() const
     peaksOutcome.invalidateInterpolated();
 }
 
+//! Discards the diffractograms, but keeps the raw intensities they are recomputed from.
 void Session::onNormalization() const
 {
+    activeClusters.avgDfgram.invalidate();
     for (auto const& cluster: dataset.allClusters)
         cluster->dfgrams.clear_vector();
 }
 
+void Session::onCorrection() const
+{
+    activeClusters.invalidateAvg();
+    for (auto const& cluster: dataset.allClusters)
+        cluster->invalidateDfgrams();
+}
+
 //! Removes all data, sets all parameters to their defaults. No need to invalidate caches?
 void Session::clear()
 {
     dataset.clear();
     corrset.clear();
+    detectorMask.clear();
     // params.clear(); TODO
     baseline.clear();
     peaksSettings.clear();
+    angleMap.invalidate();
 }
 
 void Session::sessionFromJson(const QByteArray& json)
@@ -94,6 +116,7 @@ void Session::sessionFromJson(const QByteArray& json)
 
     dataset.fromJson(top.loadObj("dataset"));
     corrset.fromJson(top.loadObj("corrset"));
+    detectorMask.fromJson(top.loadObj("detector mask", true));
     peaksSettings.fromJson(top.loadArr("peaks"));
     baseline.fromJson(top.loadObj("baseline"));
 
@@ -114,6 +137,7 @@ QByteArray Session::serializeSession() const
 
     top.insert("dataset", dataset.toJson());
     top.insert("corrset", corrset.toJson());
+    top.insert("detector mask", detectorMask.toJson());
     top.insert("peaks", peaksSettings.toJson());
     top.insert("baseline", baseline.toJson());
 
@@ -19,7 +19,9 @@
 #include "core/calc/allpeaks_allinfos.h"
 #include "core/data/corrset.h"
 #include "core/data/dataset.h"
+#include "core/data/detector_mask.h"
 #include "core/data/gamma_selection.h"
+#include "core/data/histogram_cache.h"
 #include "core/data/theta_selection.h"
 #include "core/pars/baseline.h"
 #include "core/pars/params.h"
@@ -48,10 +50,12 @@ public:
 
     void onDetector() const;      //!< detector detector has changed
     void onCut() const;           //!< image cuts have changed
+    void onGammaSelection() const; //!< gamma slicing or gamma limits have changed
     void onBaseline() const;      //!< settings for baseline fit have changed
     void onPeaks() const;         //!< a peak has been added or removed
     void onInterpol() const;      //!< interpolation control parameters have changed
     void onNormalization() const; //!< normalization parameters have changed
+    void onCorrection() const;    //!< correction file or its activation have changed
 
     // const methods:
     QByteArray serializeSession() const; // TODO rename toJson
@@ -73,13 +77,21 @@ public:
     /* order matters for destruction... */
     Dataset dataset;                    //!< raw data files with sample detector images
     Corrset corrset;                    //!< raw data files with standard sample image
+    DetectorMask detectorMask;          //!< pixels excluded from projection
     Params  params;                     //!< global parameters like detector geometry, ...
     GammaSelection gammaSelection; // TODO reconsider
     ThetaSelection thetaSelection; // TODO reconsider
     Baseline baseline;                  //!< ranges and other parameters for baseline fitting
     AllPeaksSettings peaksSettings;     //!< ranges and other parameters for Bragg peak fitting
     ActiveClusters activeClusters;      //!< list of all clusters except the unselected ones
-    lazy_data::KeyedCache<AngleMap,deg> angleMap; //!< to accelerate the projection image->dfgram
+    //! To accelerate the projection image->dfgram; one map per detector geometry and mid 2theta.
+    lazy_data::LruCache<AngleMap,AngleMapKey> angleMap {size_t(1) << 30};
+    //! Resident images of files loaded with dataset.lazyImages set.
+    ImagePool imagePool {size_t(1) << 31};
+    //! Decoded images of files loaded with dataset.compressImages set.
+    ImagePool framePool {size_t(1) << 28};
+    //! Projections of single measurements, if enabled.
+    HistogramCache memberHistograms {size_t(1) << 30};
 
 private:
     size2d imageSize_; //!< All images must have this same size
@@ -0,0 +1,32 @@
+//  ***********************************************************************************************
+//
+//  Steca: stress and texture calculator
+//
+//! @file      core/typ/histogram.cpp
+//! @brief     Implements class Histogram
+//!
+//! @homepage  https://github.com/scgmlz/Steca
+//! @license   GNU General Public License v3 or higher (see COPYING)
+//! @copyright Forschungszentrum Jülich GmbH 2016-2018
+//! @authors   Scientific Computing Group at MLZ (see CITATION, MAINTAINER)
+//
+//  ***********************************************************************************************
+
+#include "core/typ/histogram.h"
+#include "qcr/base/debug.h"
+
+Histogram::Histogram(double xMin_, double dx_, int n)
+    : xMin{xMin_}
+    , dx{dx_}
+    , intens(n, 0.)
+    , counts(n, 0)
+{}
+
+void Histogram::add(const Histogram& that)
+{
+    ASSERT(that.size() == size());
+    for (int i=0; i<size(); ++i) {
+        intens[i] += that.intens[i];
+        counts[i] += that.counts[i];
+    }
+}
@@ -0,0 +1,38 @@
+//  ***********************************************************************************************
+//
+//  Steca: stress and texture calculator
+//
+//! @file      core/typ/histogram.h
+//! @brief     Defines class Histogram
+//!
+//! @homepage  https://github.com/scgmlz/Steca
+//! @license   GNU General Public License v3 or higher (see COPYING)
+//! @copyright Forschungszentrum Jülich GmbH 2016-2018
+//! @authors   Scientific Computing Group at MLZ (see CITATION, MAINTAINER)
+//
+//  ***********************************************************************************************
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <vector>
+
+//! Intensity sums and pixel counts in equidistant bins. Unnormalized precursor of a Curve.
+
+class Histogram {
+public:
+    Histogram() {} //!< empty histogram
+    Histogram(double xMin, double dx, int n);
+
+    void add(const Histogram&); //!< add binwise; grids must be equal
+
+    bool isEmpty() const { return intens.empty(); }
+    int size() const { return intens.size(); }
+    double x(int i) const { return xMin + dx * i; }
+
+    double xMin {0}, dx {0}; //!< left edge of first bin, bin width
+    std::vector<double> intens;
+    std::vector<int> counts;
+};
+
+#endif // HISTOGRAM_H
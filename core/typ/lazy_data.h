@@ -3,7 +3,7 @@
 //  Steca: stress and texture calculator
 //
 //! @file      core/typ/lazy_data.h
-//! @brief     Defines and implements the class templates Cached, CachingVector, KeyedCache
+//! @brief     Defines and implements the class templates Cached, CachingVector, LruCache
 //!
 //! @homepage  https://github.com/scgmlz/Steca
 //! @license   GNU General Public License v3 or higher (see COPYING)
@@ -15,13 +15,16 @@
 #ifndef LAZY_DATA_H
 #define LAZY_DATA_H
 
+#include <algorithm>
+#include <cstddef>
 #include <functional>
 #include <memory>
+#include <utility>
 #include <vector>
 
 //! Data caches that are evaluated just in time.
 
-//! This namespace contains the class templates Cached, CachingVector, KeyedCache.
+//! This namespace contains the class templates Cached, CachingVector, LruCache.
 //! These classes hold payload data and computation methods. Payload data are computed
 //! when needed for the first time. Then they remain cached until explicitly invalidated.
 
@@ -35,7 +38,9 @@ public:
     Cached(std::function<TPayload(TRemakeArgs...)> f) : remake_{f} {}
     Cached(const Cached&) = delete;
     Cached(Cached&&) = default;
-    void invalidate() const { cached_.release(); }
+    void invalidate() const { cached_.reset(); }
+    //! Takes over the payload of other, which must have been computed the same way.
+    void adopt(const Cached& other) const { cached_ = std::move(other.cached_); }
     const TPayload& yield(TRemakeArgs... args) const {
         if (!cached_)
             cached_.reset( new TPayload{remake_(args...)} );
@@ -91,21 +96,56 @@ private:
     const std::function<TPayload(int,TRemakeArgs...)> remakeOne_;
 };
 
-//! Cached object with key.
+//! Cache of several objects with different keys; least recently used ones are evicted.
+
+//! TPayload must be constructible from TKey, and must have a method memSize() that returns
+//! its approximate memory footprint in bytes. Whenever the total footprint exceeds the
+//! memory budget, objects are evicted, starting with the least recently used one.
+//! The most recently used object is never evicted, so that a reference obtained from get()
+//! remains valid until the next call of get() or invalidate().
 template<typename TPayload, typename TKey>
-class KeyedCache {
+class LruCache {
 public:
-    void invalidate() const { cached_.release(); }
-    const TPayload& get(const TKey key) const {
-        if (!cached_ || key!=key_) {
-            cached_.reset( new TPayload{key} );
-            key_ = key;
+    LruCache() = delete;
+    LruCache(size_t budget) : budget_{budget} {}
+    LruCache(const LruCache&) = delete;
+    void invalidate() const { entries_.clear(); }
+    const TPayload& get(const TKey& key) const {
+        for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+            if (it->first == key) {
+                ++hits_;
+                std::rotate(it, it + 1, entries_.end()); // move to back
+                return *entries_.back().second;
+            }
         }
-        return *cached_;
+        ++misses_;
+        entries_.emplace_back(key, std::unique_ptr<TPayload>(new TPayload{key}));
+        trim();
+        return *entries_.back().second;
+    }
+    void setBudget(size_t budget) { budget_ = budget; trim(); }
+    size_t budget() const { return budget_; }
+    size_t memSize() const {
+        size_t ret = 0;
+        for (const auto& entry : entries_)
+            ret += entry.second->memSize();
+        return ret;
     }
+    int size() const { return entries_.size(); }
+    int hits() const { return hits_; }
+    int misses() const { return misses_; }
 private:
-    mutable std::unique_ptr<TPayload> cached_;
-    mutable TKey key_;
+    void trim() const {
+        size_t total = memSize();
+        while (entries_.size() > 1 && total > budget_) {
+            total -= entries_.front().second->memSize();
+            entries_.erase(entries_.begin());
+        }
+    }
+    size_t budget_;
+    mutable std::vector<std::pair<TKey,std::unique_ptr<TPayload>>> entries_; //!< MRU last
+    mutable int hits_ {0};
+    mutable int misses_ {0};
 };
 
 } // namespace lazy_data
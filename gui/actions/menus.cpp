@@ -35,9 +35,17 @@ Menus::Menus(QMenuBar* mbar)
         "&File",
         {   &triggers->addFiles,
                 &triggers->removeFile,
+                &toggles->lazyImages,
+                &toggles->scratchImages,
+                &toggles->compressImages,
+                &toggles->cacheRawfiles,
+                &toggles->compressRawfileCache,
+                &toggles->cacheMemberHistograms,
                 separator(),
                 &triggers->corrFile,
                 &toggles->enableCorr,
+                &toggles->keepCorrected,
+                &triggers->maskFile,
                 separator(),
                 &triggers->loadSession,
                 &triggers->saveSession,
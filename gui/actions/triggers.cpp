@@ -40,6 +40,7 @@ Triggers::Triggers()
     checkUpdate    .setTriggerHook([](){ CheckUpdate _(gGui); });
     clearSession   .setTriggerHook([](){ gSession->clear(); });
     corrFile       .setTriggerHook([](){ loadData::loadCorrFile(gGui); });
+    maskFile       .setTriggerHook([](){ loadData::loadMaskFile(gGui); });
     exportDfgram   .setTriggerHook([](){ ExportDfgram{}.exec(); });
     exportPolefig  .setTriggerHook([](){ ExportPolefig{}.exec(); });
     exportBigtable .setTriggerHook([](){ ExportBigtable{}.exec(); });
@@ -63,4 +64,10 @@ Triggers::Triggers()
             QString text = QString{hasCorr ? "Remove" : "Add"} + " correction file";
             corrFile.setText(text);
             corrFile.setToolTip(text.toLower()); });
+    maskFile.setRemake([this]() {
+            bool hasMask = gSession->detectorMask.hasFile();
+            maskFile.setIcon(QIcon{hasMask ? ":/icon/rem" : ":/icon/add"});
+            QString text = QString{hasMask ? "Remove" : "Add"} + " detector mask";
+            maskFile.setText(text);
+            maskFile.setToolTip(text.toLower()); });
 }
@@ -33,6 +33,7 @@ public:
     QcrTrigger clearSession {"clearSession", "Clear session"};
     QcrTrigger corrFile {"loadCorr", "Add correction file...", ":/icon/add",
             Qt::SHIFT | Qt::CTRL | Qt::Key_O};
+    QcrTrigger maskFile {"loadMask", "Add detector mask...", ":/icon/add"};
     QcrTrigger exportDfgram {"exportDfgram", "Export diffractogram(s)...", ":/icon/filesave" };
     QcrTrigger exportPolefig {"exportPolefig", "Export pole figure...", ":/icon/filesave" };
     QcrTrigger exportBigtable {"exportBigtable", "Export fit result table...", ":/icon/filesave" };
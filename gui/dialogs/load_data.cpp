@@ -60,3 +60,20 @@ void loadData::loadCorrFile(QWidget* parent)
         }
     }
 }
+
+void loadData::loadMaskFile(QWidget* parent)
+{
+    if (gSession->detectorMask.hasFile()) {
+        gSession->detectorMask.removeFile();
+    } else {
+        QString fileName = file_dialog::queryImportFileName(
+            parent, "Set detector mask", dataDir_, dataFormats);
+        if (fileName.isEmpty())
+            return;
+        try {
+            gSession->detectorMask.loadFile(fileName);
+        } catch (const Exception& ex) {
+            qWarning() << ex.msg();
+        }
+    }
+}
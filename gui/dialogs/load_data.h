@@ -20,6 +20,7 @@ class QWidget;
 namespace loadData {
     void addFiles(QWidget*);
     void loadCorrFile(QWidget*);
+    void loadMaskFile(QWidget*);
 } // ioSession
 
 #endif // LOAD_DATA_H
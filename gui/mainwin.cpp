@@ -114,6 +114,7 @@ void MainWin::refresh()
     bool hasPeak = gSession->peaksSettings.size();
     bool hasBase = gSession->baseline.ranges.size();
     toggles->enableCorr.setEnabled(gSession->hasCorrFile());
+    toggles->keepCorrected.setEnabled(gSession->hasCorrFile());
     triggers->exportDfgram.setEnabled(hasData);
     triggers->exportBigtable.setEnabled(hasData && hasPeak);
     triggers->exportDiagram.setEnabled(hasData && hasPeak);
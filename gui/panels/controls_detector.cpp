@@ -165,6 +165,12 @@ GammaControls::GammaControls()
     line1->addWidget(new QcrSpinBox
                       {"numSlices", &gSession->gammaSelection.numSlices, 2, false, 1, INT_MAX,
                               "Number of γ slices (0: no slicing, take entire image)" });
+    line1->addWidget(new QLabel{"fine γ bins"});
+    line1->addWidget(new QcrSpinBox
+                      {"numFineBins", &gSession->gammaSelection.numFineBins, 4, false, 0, INT_MAX,
+                              "Number of fine γ bins kept per cluster, so that slices can be"
+                              " changed without reprojecting the images; slice limits are rounded"
+                              " to these bins (0: no fine binning, project each slice exactly)" });
     line1->addStretch(1);
 
     auto* cellmin = new QcrCell<double>{0.};
@@ -174,11 +180,11 @@ GammaControls::GammaControls()
     cellmax->setCoerce([](const double val){return 0.01*std::round(val/0.01);});
     cellmin->setHook([](const double val){
         gSession->gammaSelection.limitedGammaRange.setMin(val);
-        gSession->onDetector();
+        gSession->onGammaSelection();
     });
     cellmax->setHook([](const double val){
         gSession->gammaSelection.limitedGammaRange.setMax(val);
-        gSession->onDetector();
+        gSession->onGammaSelection();
     });
     auto* spinmin = new QcrDoubleSpinBox{"adhoc_min", cellmin, 4, 2, -180., 180.};
     auto* spinmax = new QcrDoubleSpinBox{"adhoc_max", cellmax, 4, 2, -180., 180.};
@@ -192,7 +198,7 @@ GammaControls::GammaControls()
             spinmin->setMinimum(gSession->currentCluster()->rangeGma().min);
         }
         gSession->gammaSelection.limit = val;
-        gSession->onDetector();
+        gSession->onGammaSelection();
         spinmax->setEnabled(val);
         spinmin->setEnabled(val);
     });
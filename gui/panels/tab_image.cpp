@@ -53,12 +53,13 @@ void addOverlay(QImage& img, double midTth)
 {
     gSession->gammaSelection.onData();
     gSession->thetaSelection.onData();
-    const AngleMap& angleMap = gSession->angleMap.get(midTth);
-    const Range& rgeGma = gSession->gammaSelection.currentRange();
-    const Range& rgeTth = gSession->thetaSelection.range();
+    // the ranges may need other AngleMaps, which could evict this one; so get them first
+    const Range rgeGma = gSession->gammaSelection.currentRange();
+    const Range rgeTth = gSession->thetaSelection.range();
+    const AngleMap& angleMap = gSession->angleMap.get(deg{midTth});
     for (int j=0; j<img.size().height(); ++j) {
         for (int i=0; i<img.size().width(); ++i) {
-            const ScatterDirection& a = angleMap.dirAt2(i, j);
+            const ScatterDirection a = angleMap.dirAt2(i, j);
             QColor color = img.pixel(i, j);
             if (rgeGma.contains(a.gma)) {
                 if (rgeTth.contains(a.tth))
@@ -111,9 +112,9 @@ QPixmap ImageTab::blankPixmap()
     return pixmap;
 }
 
-QImage ImageTab::makeImage(const Image& image)
+QImage ImageTab::makeImage(const Image& image, bool corrected)
 {
-    ImageLens imageLens(image, true, false);
+    ImageLens imageLens(image, true, false, corrected);
     const size2d sz = imageLens.imgSize();
     if (sz.isEmpty())
         return {};
@@ -218,7 +219,9 @@ QPixmap DataImageTab::pixmap()
     const Measurement* m = measurement();
     if (!m)
         return blankPixmap();
-    QImage img = makeImage(m->image());
+    const Corrset& corrset = gSession->corrset;
+    QImage img = corrset.useCorrectedImages()
+        ? makeImage(corrset.correctedImage(*m), true) : makeImage(*m->image());
     if (gGui->toggles->showBins.getValue())
         addOverlay(img, m->midTth());
     return QPixmap::fromImage(img);
@@ -29,7 +29,7 @@ protected:
     void render();
     virtual QPixmap pixmap() = 0;
     QPixmap blankPixmap();
-    QImage makeImage(const Image&);
+    QImage makeImage(const Image&, bool corrected=false);
     class QHBoxLayout* box1_;
     class QVBoxLayout* controls_;
     class ImageView* imageView_;
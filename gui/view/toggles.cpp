@@ -20,6 +20,20 @@ Toggles::Toggles()
         "All measurements", ":/icon/all"}
     , enableCorr {"enableCorr", &gSession->corrset.enabled,
         "Enable correction file", ":/icon/useCorrection"}
+    , keepCorrected {"keepCorrected", &gSession->corrset.keepCorrected,
+        "Keep corrected images in memory"}
+    , lazyImages {"lazyImages", &gSession->dataset.lazyImages,
+        "Load images on demand"}
+    , scratchImages {"scratchImages", &gSession->dataset.scratchImages,
+        "Keep images in a memory-mapped scratch file"}
+    , compressImages {"compressImages", &gSession->dataset.compressImages,
+        "Keep images compressed in memory"}
+    , cacheRawfiles {"cacheRawfiles", &gSession->dataset.cacheRawfiles,
+        "Cache loaded files for fast reloading"}
+    , compressRawfileCache {"compressRawfileCache", &gSession->dataset.compressRawfileCache,
+        "Compress the file cache"}
+    , cacheMemberHistograms {"cacheMemberHistograms", &gSession->memberHistograms.enabled,
+        "Cache projections of single measurements"}
     , linkCuts {"linkCuts", &gSession->params.imageCut.linked,
               "Link the four cut settings", ":/icon/link"}
 {}
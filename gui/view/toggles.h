@@ -25,6 +25,13 @@ public:
     QcrToggle combinedDfgram;
     QcrToggle crosshair {"crosshair", "Show crosshair", false, ":/icon/crop"};
     QcrToggle enableCorr;
+    QcrToggle keepCorrected;
+    QcrToggle lazyImages;
+    QcrToggle scratchImages;
+    QcrToggle compressImages;
+    QcrToggle cacheRawfiles;
+    QcrToggle compressRawfileCache;
+    QcrToggle cacheMemberHistograms;
     QcrToggle fixedIntenDfgram {"dfg.fixInt", "Fixed intensity scale", false, ":/icon/scale"};
     QcrToggle fixedIntenImage {"img.fixInt", "Global intensity scale", false, ":/icon/scale"};
     QcrToggle linkCuts;
@@ -38,6 +38,20 @@ TEST(Caches, SimpleWithArg) {
     EXPECT_EQ(sqrt(5), cache.yield(5)); // recompute
 }
 
+// Test and demonstrate usage of Cached::adopt, which moves a payload to another cache.
+TEST(Caches, Adopt) {
+    static int N = 0; // Auxiliary, to count computations.
+    auto f = []()->int{ return ++N; };
+    lazy_data::Cached<int> oldCache{ f };
+    lazy_data::Cached<int> newCache{ f };
+    EXPECT_EQ(1, oldCache.yield()); // compute
+    newCache.adopt(oldCache);
+    EXPECT_EQ(nullptr, oldCache.current());
+    EXPECT_EQ(1, newCache.yield()); // do not recompute
+    newCache.adopt(oldCache); // adopting an empty cache invalidates
+    EXPECT_EQ(2, newCache.yield()); // recompute
+}
+
 // Minimal example to test and demonstrate usage of VectorCache.
 TEST(Caches, Vector) {
     static int N = 10; // Auxiliary, to let the remake function depend on something.
@@ -57,3 +71,36 @@ TEST(Caches, Vector) {
     EXPECT_EQ(1000, cache.yield_at(0)); // recompute
     EXPECT_EQ(1002, cache.yield_at(2)); // do not recompute
 }
+
+// Test and demonstrate usage of LruCache.
+// Payload is constructed from the key, and reports its memory footprint.
+TEST(Caches, Lru) {
+    static int N = 0; // Auxiliary, to count constructions.
+    struct Payload {
+        Payload(int key) : val{key*key} { ++N; }
+        size_t memSize() const { return 10; }
+        int val;
+    };
+    lazy_data::LruCache<Payload,int> cache{ 25 }; // room for two payloads
+    EXPECT_EQ(4, cache.get(2).val); // compute
+    EXPECT_EQ(9, cache.get(3).val); // compute
+    EXPECT_EQ(4, cache.get(2).val); // do not recompute; 2 is now most recently used
+    EXPECT_EQ(2, N);
+    EXPECT_EQ(2, cache.size());
+    EXPECT_EQ(16, cache.get(4).val); // compute, evict 3
+    EXPECT_EQ(2, cache.size());
+    EXPECT_EQ(20, cache.memSize());
+    EXPECT_EQ(4, cache.get(2).val); // do not recompute
+    EXPECT_EQ(3, N);
+    EXPECT_EQ(9, cache.get(3).val); // recompute, evict 4
+    EXPECT_EQ(4, N);
+    EXPECT_EQ(2, cache.hits());
+    EXPECT_EQ(4, cache.misses());
+    cache.setBudget(5); // too small even for one payload, but the newest is kept
+    EXPECT_EQ(1, cache.size());
+    EXPECT_EQ(9, cache.get(3).val); // do not recompute
+    cache.invalidate();
+    EXPECT_EQ(0, cache.size());
+    EXPECT_EQ(9, cache.get(3).val); // recompute
+    EXPECT_EQ(5, N);
+}
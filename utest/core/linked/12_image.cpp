@@ -0,0 +1,87 @@
+#include "gtest/gtest.h"
+#include "core/raw/compressed_frame.h"
+#include "core/raw/image.h"
+#include "core/raw/pixel_store.h"
+#include <vector>
+
+TEST(Image, Dense) {
+    Image im(size2d(2, 2), std::vector<float>{1, 2, 0, 4});
+    EXPECT_FALSE(im.isSparse());
+    EXPECT_EQ(4, im.inten2d(1, 1));
+    EXPECT_EQ(0, im.rgeInten().min);
+    EXPECT_EQ(4, im.rgeInten().max);
+}
+
+TEST(Image, Sparse) {
+    std::vector<float> intens(100, 0.f);
+    intens[7] = 3;
+    intens[42] = -1;
+    Image im(size2d(10, 10), std::vector<float>(intens));
+    EXPECT_TRUE(im.isSparse());
+    EXPECT_FALSE(im.isEmpty());
+    EXPECT_EQ(2, im.sparseIndexes().size());
+    EXPECT_EQ(3, im.inten1d(7));
+    EXPECT_EQ(-1, im.inten2d(2, 4));
+    EXPECT_EQ(0, im.inten1d(8));
+    EXPECT_EQ(-1, im.rgeInten().min);
+    EXPECT_EQ(3, im.rgeInten().max);
+    EXPECT_EQ(intens, im.denseIntens());
+}
+
+TEST(Image, AddSparse) {
+    std::vector<float> intens(100, 0.f);
+    intens[7] = 3;
+    Image sum(size2d(10, 10), 1.f);
+    sum.addImage(Image(size2d(10, 10), std::move(intens)));
+    EXPECT_FALSE(sum.isSparse());
+    EXPECT_EQ(4, sum.inten1d(7));
+    EXPECT_EQ(1, sum.inten1d(8));
+
+    std::vector<float> more(100, 0.f);
+    more[9] = 5;
+    Image sparse(size2d(10, 10), std::move(more));
+    sparse.setInten1d(0, 2); // converts to dense
+    EXPECT_FALSE(sparse.isSparse());
+    EXPECT_EQ(2, sparse.inten1d(0));
+    EXPECT_EQ(5, sparse.inten1d(9));
+}
+
+TEST(Image, InScratchFile) {
+    const auto store = std::make_shared<ScratchFileStore>(1024); // room for 256 pixels per segment
+    std::vector<Image> images;
+    for (int k=0; k<5; ++k) {
+        std::vector<float> intens(100);
+        for (int i=0; i<100; ++i)
+            intens[i] = k * 1000 + i + 1;
+        images.emplace_back(size2d(10, 10), std::move(intens), store);
+    }
+    EXPECT_EQ(3 * 1024, store->fileSize()); // two images per segment
+    for (int k=0; k<5; ++k) {
+        EXPECT_FALSE(images[k].isSparse());
+        EXPECT_EQ(k * 1000 + 1, images[k].rgeInten().min);
+        EXPECT_EQ(k * 1000 + 100, images[k].inten2d(9, 9));
+    }
+    images[1].setInten1d(0, -1); // copies the pixels to the heap
+    EXPECT_EQ(-1, images[1].inten1d(0));
+    EXPECT_EQ(1002, images[1].inten1d(1));
+    EXPECT_EQ(2001, images[2].inten1d(0));
+}
+
+TEST(Image, Compressed) {
+    EXPECT_FALSE(CompressedFrame::canHold({1, 2.5f}));
+    EXPECT_FALSE(CompressedFrame::canHold({1, -1}));
+    EXPECT_FALSE(CompressedFrame::canHold({1, NAN}));
+    for (const float top : {1000.f, 100000.f}) { // 16 and 32 bit counts
+        std::vector<float> intens(64 * 64);
+        for (int i=0; i<intens.size(); ++i)
+            intens[i] = (i / 64) % 50 + (i == 123 ? top : 0);
+        ASSERT_TRUE(CompressedFrame::canHold(intens));
+        const CompressedFrame frame(size2d(64, 64), intens);
+        EXPECT_LT(frame.memSize(), intens.size() * sizeof(float) / 2);
+        EXPECT_EQ(0, frame.rgeInten().min);
+        EXPECT_EQ(top + 1, frame.rgeInten().max);
+        const Image im = frame.decode();
+        EXPECT_EQ(size2d(64, 64), im.size());
+        EXPECT_EQ(intens, im.denseIntens());
+    }
+}
@@ -0,0 +1,44 @@
+#include "gtest/gtest.h"
+#include "core/loaders/fastyamlloader.h"
+#include "core/base/exception.h"
+#include <string>
+
+using loadYAML::YamlArray2d;
+using loadYAML::parseArray2d;
+
+namespace {
+
+YamlArray2d parse(const std::string& text)
+{
+    YamlArray2d ret;
+    parseArray2d(text.data(), text.size(), ret);
+    return ret;
+}
+
+} // namespace
+
+TEST(YamlArray2d, Small) {
+    const YamlArray2d a = parse("3 2\n[ 1 2 -3\n  40 +5 0 ]");
+    EXPECT_EQ(3, a.width);
+    EXPECT_EQ(2, a.height);
+    EXPECT_EQ(std::vector<float>({1, 2, -3, 40, 5, 0}), a.data);
+}
+
+TEST(YamlArray2d, Large) {
+    const int w = 1000, h = 2000;
+    std::string text = std::to_string(w) + " " + std::to_string(h) + " [";
+    for (int i=0; i<w*h; ++i)
+        text += std::to_string(i % 65536) + (i % w == w - 1 ? "\n " : " ");
+    text += "]";
+    const YamlArray2d a = parse(text);
+    ASSERT_EQ(w * h, a.data.size());
+    for (int i=0; i<w*h; ++i)
+        ASSERT_EQ(i % 65536, a.data[i]);
+}
+
+TEST(YamlArray2d, Invalid) {
+    EXPECT_THROW(parse("2 2 [1 2 3]"), Exception);
+    EXPECT_THROW(parse("2 2 [1 2 3 4 5]"), Exception);
+    EXPECT_THROW(parse("2 2 [1 2 x 4]"), Exception);
+    EXPECT_THROW(parse("2 2 1 2 3 4"), Exception);
+}
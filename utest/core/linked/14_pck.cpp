@@ -0,0 +1,120 @@
+#include "gtest/gtest.h"
+#include "core/loaders/unpack_pck.h"
+#include "3rdparty/Mar/MarReader.h"
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+// Checks load::unpackPck against get_pck from 3rdparty/Mar, on images packed by a simple encoder.
+
+namespace {
+
+//! Appends bits to a byte stream, least significant bit first.
+class BitWriter {
+public:
+    void put(unsigned value, int n)
+    {
+        for (int i=0; i<n; ++i) {
+            if (numBits_ % 8 == 0)
+                bytes.push_back(0);
+            if ((value >> i) & 1)
+                bytes.back() |= 1 << (numBits_ % 8);
+            ++numBits_;
+        }
+    }
+    std::string bytes;
+private:
+    int numBits_ = 0;
+};
+
+//! Packs img, choosing the block lengths at random, and the narrowest bit width for each block.
+std::string pack(const std::vector<short>& img, int width, std::mt19937& rng)
+{
+    const int total = img.size();
+    std::vector<int> diffs(total);
+    for (int pixel=0; pixel<total; ++pixel) {
+        int pred = 0;
+        if (pixel > width)
+            pred = (img[pixel-1] + img[pixel-width+1] + img[pixel-width] + img[pixel-width-1] + 2)
+                / 4;
+        else if (pixel != 0)
+            pred = img[pixel-1];
+        diffs[pixel] = short(img[pixel] - pred);
+    }
+    const int numBits[8] = {0, 4, 5, 6, 7, 8, 16, 32};
+    BitWriter out;
+    for (int pixel=0; pixel<total; ) {
+        const int pixExp = rng() % 8;
+        const int end = std::min(pixel + (1 << pixExp), total);
+        auto fits = [&](int bitExp) {
+            const long long limit = numBits[bitExp] ? 1LL << (numBits[bitExp] - 1) : 0;
+            for (int i=pixel; i<end; ++i)
+                if (diffs[i] < -limit || diffs[i] >= std::max(limit, 1LL))
+                    return false;
+            return true;
+        };
+        int bitExp = 0;
+        while (!fits(bitExp))
+            ++bitExp;
+        if (bitExp < 7 && rng() % 4 == 0)
+            ++bitExp; // also exercise wider blocks than needed
+        out.put(pixExp | bitExp << 3, 6);
+        for (; pixel<end; ++pixel)
+            out.put(diffs[pixel], numBits[bitExp]);
+    }
+    return out.bytes;
+}
+
+void checkImage(const std::vector<short>& img, int width, int height, std::mt19937& rng)
+{
+    char header[64];
+    sprintf(header, "\nCCP4 packed image, X: %04d, Y: %04d\n", width, height);
+    const std::string file = std::string("mar345 header\n") + header + pack(img, width, rng);
+
+    std::vector<short> expected(width * height);
+    FILE* fp = tmpfile();
+    ASSERT_TRUE(fp);
+    fwrite(file.data(), 1, file.size(), fp);
+    get_pck(fp, expected.data());
+    fclose(fp);
+
+    const uchar* data = reinterpret_cast<const uchar*>(file.data());
+    int w, h;
+    const qint64 start = load::findPck(data, file.size(), w, h);
+    ASSERT_LT(0, start);
+    EXPECT_EQ(width, w);
+    EXPECT_EQ(height, h);
+    std::vector<float> actual(width * height);
+    load::unpackPck(data + start, file.size() - start, w, h, actual.data());
+    for (int i=0; i<width*height; ++i) {
+        ASSERT_EQ((unsigned short)img[i], actual[i]) << "pixel " << i;
+        ASSERT_EQ((unsigned short)expected[i], actual[i]) << "pixel " << i;
+    }
+}
+
+} // namespace
+
+TEST(Pck, Smooth) {
+    std::mt19937 rng(1);
+    const int width = 37, height = 23;
+    std::vector<short> img(width * height);
+    for (int i=0; i<width*height; ++i)
+        img[i] = 100 + (i % width) * 3 + (i / width) * 2 + rng() % 5;
+    checkImage(img, width, height, rng);
+}
+
+TEST(Pck, Noisy) {
+    std::mt19937 rng(2);
+    const int width = 64, height = 50;
+    std::vector<short> img(width * height);
+    for (int i=0; i<width*height; ++i)
+        img[i] = rng() % 3 ? rng() % 200 : rng() % 65536; // includes values read as negative
+    checkImage(img, width, height, rng);
+}
+
+TEST(Pck, Zeros) {
+    std::mt19937 rng(3);
+    const int width = 16, height = 16;
+    checkImage(std::vector<short>(width * height, 0), width, height, rng);
+}
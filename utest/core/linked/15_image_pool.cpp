@@ -0,0 +1,64 @@
+#include "gtest/gtest.h"
+#include "core/raw/image_pool.h"
+#include <vector>
+
+namespace {
+
+// Dense 10x10 image with all pixels set to val.
+Image makeImage(float val)
+{
+    return Image(size2d(10, 10), std::vector<float>(100, val));
+}
+
+} // namespace
+
+TEST(ImagePool, LoadOnDemand) {
+    int numLoads = 0;
+    const size_t one = makeImage(1).memSize();
+    ImagePool pool(2 * one + one / 2); // room for two images
+    ImageSlot a, b, c;
+    auto load = [&numLoads](float val) {
+        return [&numLoads, val]() { ++numLoads; return makeImage(val); }; };
+    EXPECT_EQ(1, pool.get(a, load(1))->inten1d(0));
+    EXPECT_EQ(2, pool.get(b, load(2))->inten1d(0));
+    EXPECT_EQ(1, pool.get(a, load(1))->inten1d(0)); // do not reload; a is now most recent
+    EXPECT_EQ(2, numLoads);
+    EXPECT_EQ(3, pool.get(c, load(3))->inten1d(0)); // release b
+    EXPECT_EQ(2, pool.size());
+    EXPECT_EQ(2 * one, pool.memSize());
+    EXPECT_TRUE(b.expired());
+    EXPECT_EQ(1, pool.get(a, load(1))->inten1d(0)); // do not reload
+    EXPECT_EQ(3, numLoads);
+    EXPECT_EQ(2, pool.get(b, load(2))->inten1d(0)); // reload, release c
+    EXPECT_EQ(4, numLoads);
+    EXPECT_TRUE(c.expired());
+}
+
+TEST(ImagePool, HeldImagesSurvive) {
+    ImagePool pool(1); // too small even for one image, but the newest is kept
+    ImageSlot a, b;
+    const std::shared_ptr<const Image> held = pool.get(a, []() { return makeImage(1); });
+    pool.get(b, []() { return makeImage(2); });
+    EXPECT_EQ(1, pool.size());
+    EXPECT_FALSE(a.expired()); // released by the pool, but still in use
+    EXPECT_EQ(held, pool.get(a, []() { return makeImage(7); })); // do not reload
+    EXPECT_EQ(1, held->inten1d(99));
+    pool.clear();
+    EXPECT_EQ(0, pool.size());
+    EXPECT_EQ(0, pool.memSize());
+}
+
+TEST(ImagePool, SlotLifetime) {
+    ImagePool pool(size_t(1) << 20);
+    {
+        std::vector<ImageSlot> slots(1);
+        pool.get(slots[0], []() { return makeImage(1); });
+        slots.resize(100); // moves the slot, which must stay resident
+        EXPECT_EQ(1, pool.size());
+        EXPECT_EQ(1, pool.get(slots[0], []() { return makeImage(7); })->inten1d(0));
+        pool.get(slots[1], []() { return makeImage(2); });
+        EXPECT_EQ(2, pool.size());
+    }
+    EXPECT_EQ(0, pool.size()); // destroyed slots release their images
+    EXPECT_EQ(0, pool.memSize());
+}
@@ -0,0 +1,43 @@
+#include "gtest/gtest.h"
+#include "core/data/histogram_cache.h"
+
+namespace {
+
+// The cache only compares Measurement addresses, so any distinct objects will do.
+const int dummies[3] {};
+const Measurement* measurement(int i) { return reinterpret_cast<const Measurement*>(dummies + i); }
+
+HistogramCache::Key makeKey(int numBins)
+{
+    return {Range(-10, 10), 1, false, deg(20), deg(0.1), numBins, -1};
+}
+
+std::vector<Histogram> makeHists(int numBins, double inten)
+{
+    std::vector<Histogram> ret(1, Histogram(20, 0.1, numBins));
+    ret[0].intens.assign(numBins, inten);
+    return ret;
+}
+
+} // namespace
+
+TEST(HistogramCache, FindAndEvict) {
+    // An entry takes about 1200 bytes per 100 bins, plus a small overhead.
+    HistogramCache cache(2500); // room for one entry with 100 bins and one with 50 bins
+    EXPECT_EQ(nullptr, cache.find(measurement(0), makeKey(100)));
+    cache.insert(measurement(0), makeKey(100), makeHists(100, 1));
+    cache.insert(measurement(0), makeKey(50), makeHists(50, 2)); // same measurement, other grid
+    ASSERT_NE(nullptr, cache.find(measurement(0), makeKey(100))); // now most recently used
+    EXPECT_EQ(1, cache.find(measurement(0), makeKey(100))->at(0).intens.at(99));
+    EXPECT_EQ(2, cache.find(measurement(0), makeKey(50))->at(0).intens.at(0));
+    EXPECT_EQ(nullptr, cache.find(measurement(1), makeKey(100)));
+    cache.insert(measurement(1), makeKey(100), makeHists(100, 3)); // evicts the oldest
+    EXPECT_EQ(nullptr, cache.find(measurement(0), makeKey(100)));
+    EXPECT_NE(nullptr, cache.find(measurement(0), makeKey(50)));
+    EXPECT_EQ(3, cache.find(measurement(1), makeKey(100))->at(0).intens.at(0));
+    EXPECT_EQ(2, cache.size());
+    cache.clear();
+    EXPECT_EQ(0, cache.size());
+    EXPECT_EQ(0, cache.memSize());
+    EXPECT_EQ(nullptr, cache.find(measurement(1), makeKey(100)));
+}
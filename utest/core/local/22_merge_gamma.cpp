@@ -0,0 +1,64 @@
+// test functions from unnamed namespace
+
+#include "gtest/gtest.h"
+#define LOCAL_CODE_ONLY
+#include "core/data/angle_map.cpp"
+
+TEST(MergeByGamma, Empty) {
+    const std::vector<deg> gmas {1, 2, 2};
+    const std::vector<int> indexes {5, 3, 4};
+    std::vector<deg> sortedGmas;
+    std::vector<int> sortedIndexes;
+    mergeByGamma(gmas, indexes, {}, {}, sortedGmas, sortedIndexes);
+    EXPECT_EQ(indexes, sortedIndexes);
+    mergeByGamma({}, {}, gmas, indexes, sortedGmas, sortedIndexes);
+    EXPECT_EQ(indexes, sortedIndexes);
+    mergeByGamma({}, {}, {}, {}, sortedGmas, sortedIndexes);
+    EXPECT_TRUE(sortedGmas.empty());
+    EXPECT_TRUE(sortedIndexes.empty());
+}
+
+TEST(MergeByGamma, Ties) {
+    // equal gammas are ordered by index, as after a stable sort of row-major pixels
+    const std::vector<deg> gmas1 {-1, 0, 0, 3};
+    const std::vector<int> indexes1 {7, 2, 9, 0};
+    const std::vector<deg> gmas2 {0, 0, 2, 3, 4};
+    const std::vector<int> indexes2 {1, 4, 6, 8, 3};
+    std::vector<deg> sortedGmas;
+    std::vector<int> sortedIndexes;
+    mergeByGamma(gmas1, indexes1, gmas2, indexes2, sortedGmas, sortedIndexes);
+    EXPECT_EQ(std::vector<int>({7, 1, 2, 4, 9, 6, 0, 8, 3}), sortedIndexes);
+    ASSERT_EQ(9, sortedGmas.size());
+    for (int k=1; k<9; ++k)
+        EXPECT_LE(sortedGmas[k-1], sortedGmas[k]);
+}
+
+TEST(DeriveInCut, SameAsSort) {
+    // after a change of the cut, deriving the sorted list must give the same as sorting anew
+    const size2d size(13, 9);
+    std::vector<deg> allGmas(size.count());
+    for (int ind=0; ind<size.count(); ++ind)
+        allGmas[ind] = ((ind * 7919) % 23 - 11) * .5; // many ties
+    std::vector<char> excluded(size.count(), 0);
+    for (int ind=0; ind<size.count(); ind+=5)
+        excluded[ind] = 1;
+    const std::vector<PixelCut> cuts {
+        {0, 0, 0, 0}, {2, 0, 0, 0}, {0, 3, 1, 0}, {1, 1, 4, 2}, {5, 6, 0, 0}, {0, 0, 3, 5},
+        {12, 0, 0, 8}};
+    for (const std::vector<char>& ex : {std::vector<char>(), excluded}) {
+        for (const PixelCut& oldCut : cuts) {
+            for (const PixelCut& newCut : cuts) {
+                std::vector<deg> oldGmas, gmas, derivedGmas;
+                std::vector<int> oldIndexes, indexes, derivedIndexes;
+                sortInCut(allGmas, size, oldCut, ex, -5.5, 5.5, oldGmas, oldIndexes);
+                sortInCut(allGmas, size, newCut, ex, -5.5, 5.5, gmas, indexes);
+                deriveInCut(allGmas, size, oldCut, newCut, ex, oldGmas, oldIndexes,
+                            derivedGmas, derivedIndexes);
+                ASSERT_EQ(indexes, derivedIndexes);
+                ASSERT_EQ(gmas.size(), derivedGmas.size());
+                for (int k=0; k<gmas.size(); ++k)
+                    EXPECT_EQ(double(gmas[k]), double(derivedGmas[k]));
+            }
+        }
+    }
+}